@@ -1,19 +1,53 @@
 #version 400 core
 
+// has to match BLADE_SPECIES_COUNT in main.h
+#define SPECIES_COUNT 3
+
 in vec3 teCentrePos;
 in vec3 teNormal;
 in vec2 teTexturePos;
 in vec3 teRandom;
+flat in int teSpecies;
 
 out vec4 colour;
 
-uniform sampler2D alphaTexture;
-uniform sampler2D diffuseTexture;
+// one layer per kind of blade, the species says which
+uniform sampler2DArray alphaTexture;
+uniform sampler2DArray diffuseTexture;
+
+uniform int speciesAlphaLayer[SPECIES_COUNT];
+uniform int speciesDiffuseLayer[SPECIES_COUNT];
+uniform vec3 speciesRootColour[SPECIES_COUNT];
+uniform vec3 speciesTipColour[SPECIES_COUNT];
 uniform vec3 cameraPos;
 
+// when drawing into a multisampled framebuffer the mask edge is turned into a coverage ramp
+// instead of a hard cut out
+uniform bool alphaToCoverage;
+
+// the mask is black where the blade is cut away, this matches MASK_COVERAGE_THRESHOLD on the CPU
+const float maskThreshold = 0.5;
+
 void main()
 {
-	vec4 grassColour = texture(diffuseTexture, teTexturePos);
+	// derivatives aren't defined once some fragments of the quad have discarded, so we take them before
+	vec2 textureDx = dFdx(teTexturePos);
+	vec2 textureDy = dFdy(teTexturePos);
+
+	// most of the fragments of a blade quad get cut away, so the mask is tested before doing anything else
+	float mask = texture(alphaTexture, vec3(teTexturePos, speciesAlphaLayer[teSpecies])).r;
+
+	// a ramp about one pixel wide centred on the threshold, so the edge is as sharp as it can be while still
+	// giving the samples in between partial coverage
+	float coverage = clamp((mask - maskThreshold)/max(fwidth(mask), 0.0001) + 0.5, 0.0, 1.0);
+
+	if ((alphaToCoverage && coverage <= 0.0) || (!alphaToCoverage && mask < maskThreshold))
+	   discard;
+
+	vec4 grassColour = textureGrad(diffuseTexture, vec3(teTexturePos, speciesDiffuseLayer[teSpecies]), textureDx,
+								   textureDy);
+	// texturePos.x goes from the root to the tip
+	grassColour.rgb *= mix(speciesRootColour[teSpecies], speciesTipColour[teSpecies], teTexturePos.x);
 	// modifying the diffuse colour slightly for more variance
 	grassColour.r += grassColour.r*(teRandom.x*0.5 - 0.25);
 	grassColour.g += grassColour.g*(teRandom.y*0.5 - 0.25);
@@ -37,11 +71,8 @@ void main()
 	if (intensity < 0.0)
 	   intensity = -intensity;
 
-	vec4 textureColour = texture(alphaTexture, teTexturePos);
-	if (textureColour == vec4(0.0, 0.0, 0.0, 1.0))
-	   discard;
-
 	// multiplied by texture coordinate so that lower areas of the blade are darker
 	//(texturePos.x because the texture is horizontal)
 	colour = ambient + grassColour*intensity*teTexturePos.x;
+	colour.a = alphaToCoverage ? coverage : 1.0;
 }
\ No newline at end of file
@@ -8,6 +8,7 @@ in vec3 vPos[];
 in vec4 vCentrePos[];
 in vec2 vTexturePos[];
 in vec4 vRandom[];
+flat in int vSpecies[];
 
 patch out vec3 controlPoints[2];
 
@@ -15,11 +16,21 @@ out vec3 tcPos[];
 out vec3 tcCentrePos[];
 out vec2 tcTexturePos[];
 out vec3 tcRandom[];
+flat out int tcSpecies[];
 
 uniform vec3 cameraPos;
 uniform mat4 objectTransform;
 uniform mat4 viewTransform;
 
+// the height of the viewport in pixels and projectionTransform[1][1], how much of normalized device coordinates'
+// [-1, 1] a world unit one unit away from the camera covers
+uniform float viewportHeight;
+uniform float projectionScale;
+// every segment of a blade covers about this many pixels of its height
+uniform float pixelsPerSegment;
+// blades are dropped when their width across the view covers fewer pixels than this
+uniform float minFacingPixels;
+
 vec3 calcControlPoint(vec3 lower, vec3 upper)
 {
 	// scaled between -1/4 & 1/4
@@ -40,12 +51,25 @@ void main()
 
 	if (gl_InvocationID == 0)
 	{
+		//NOTE(denis): the distance rather than the view depth, so a blade's level doesn't change as the camera
+		// turns. vPos is in object space, which is only ever translated, so the blade's length is the same there
 		float cameraDistance = length(vCentrePos[0].xyz - cameraPos);
-		float distanceRatio = cameraDistance / maxDistance;
+		float pixelsPerUnit = 0.5*viewportHeight*projectionScale/cameraDistance;
+		float bladeLength = length(vPos[1] - vPos[0]);
+		float bladePixels = pixelsPerUnit*bladeLength;
+
+		// the blade's width runs along its bottom edge, which is the direction the vertex shader rotated to by
+		// pos.w. Seen edge-on the blade is only as wide as the part of that direction across the view
+		float bladeWidth = length(vPos[3] - vPos[0]);
+		vec3 widthDir = (vPos[3] - vPos[0])/bladeWidth;
+		vec3 viewDir = (vCentrePos[0].xyz - cameraPos)/cameraDistance;
+		float edgeOn = abs(dot(viewDir, widthDir));
+		float facingWidth = sqrt(max(1.0 - edgeOn*edgeOn, 0.0));
+		float facingPixels = pixelsPerUnit*facingWidth*bladeWidth;
 
 		float tessLevel = 0;
-		if (distanceRatio < 1.0)
-		   tessLevel = ceil(maxTessellation*(1.0 - distanceRatio));
+		if (cameraDistance < maxDistance && facingPixels >= minFacingPixels)
+		   tessLevel = clamp(ceil(bladePixels/pixelsPerSegment), 1.0, maxTessellation);
 
 		//NOTE(denis): quads are defined counter clockwise, starting with 0 at bottom-left corner
 		gl_TessLevelOuter[0] = tessLevel; // left edge
@@ -64,4 +88,5 @@ void main()
 	tcCentrePos[gl_InvocationID] = vCentrePos[gl_InvocationID].xyz;
 	tcTexturePos[gl_InvocationID] = vTexturePos[gl_InvocationID];
 	tcRandom[gl_InvocationID] = vRandom[gl_InvocationID].xyz;
+	tcSpecies[gl_InvocationID] = vSpecies[gl_InvocationID];
 }
\ No newline at end of file
@@ -10,11 +10,13 @@ in vec3 tcPos[];
 in vec3 tcCentrePos[];
 in vec2 tcTexturePos[];
 in vec3 tcRandom[];
+flat in int tcSpecies[];
 
 out vec3 teCentrePos;
 out vec3 teNormal;
 out vec2 teTexturePos;
 out vec3 teRandom;
+flat out int teSpecies;
 
 uniform mat4 objectTransform;
 uniform mat4 viewTransform;
@@ -62,6 +64,7 @@ void main()
 	teCentrePos = tcCentrePos[0];
 	teNormal = normal;
 	teRandom = tcRandom[0]; // since they are all the same, any would work
+	teSpecies = tcSpecies[0];
 
 	gl_Position = projectionTransform * viewTransform * objectTransform * vec4(splinePos, 1.0);
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #version 400 core
 
 #define M_PI 3.1415926535897932384626433832795
+// has to match BLADE_SPECIES_COUNT in main.h
+#define SPECIES_COUNT 3
 
 // out of the 8 random values given from the application, this shader uses three of them
 
@@ -13,6 +15,7 @@ out vec3 vPos;
 out vec4 vCentrePos;
 out vec2 vTexturePos;
 out vec4 vRandom;
+flat out int vSpecies;
 
 uniform vec2 patchPos;
 uniform vec3 fieldRect[2];
@@ -20,23 +23,66 @@ uniform mat4 objectTransform;
 uniform float time;
 uniform sampler2D forceMap;
 uniform int windActive;
+uniform sampler2D heightMap;
+uniform float heightScale;
+uniform sampler2D vegetationMap;
+
+uniform float speciesWidthScale[SPECIES_COUNT];
+uniform float speciesHeightScale[SPECIES_COUNT];
+uniform float speciesBendingScale[SPECIES_COUNT];
+
+// where a position in the patch lands on the maps that cover the whole field
+vec2 fieldMapPos(vec3 patchRelativePos)
+{
+	vec3 fieldWorldPos = vec3(patchPos.x, 0.0, patchPos.y) + (patchRelativePos + vec3(0.5, 0.0, 0.5));
+	vec3 fieldRelativePos = fieldWorldPos - fieldRect[0];
+	vec3 fieldDimensions = fieldRect[1] - fieldRect[0];
+
+	return vec2(fieldRelativePos.x / fieldDimensions.x, fieldRelativePos.z / fieldDimensions.z);
+}
+
+// the ground vertex shader samples the height in the same way so the blades stand on the ground
+float terrainHeight(vec3 patchRelativePos)
+{
+	return texture(heightMap, fieldMapPos(patchRelativePos)).r*heightScale;
+}
+
+// the vegetation map's [0, 1] is split into SPECIES_COUNT equal ranges. It is fetched rather than filtered so a
+// blade never gets a species from between two neighbouring texels
+int bladeSpecies(vec3 patchRelativePos)
+{
+	ivec2 mapSize = textureSize(vegetationMap, 0);
+	ivec2 texel = clamp(ivec2(fieldMapPos(patchRelativePos)*vec2(mapSize)), ivec2(0), mapSize - 1);
+
+	int species = int(texelFetch(vegetationMap, texel, 0).r*SPECIES_COUNT);
+	return min(species, SPECIES_COUNT - 1);
+}
 
 void main()
 {
 	vec3 newPos;
 
+	//NOTE(denis): one generated patch is drawn all over the field, so the species can't be picked when the
+	// blades are generated. Every vertex reads the map at the blade's root so the whole blade agrees
+	int species = bladeSpecies(vec3(centrePos.x, 0.0, centrePos.z));
+	float widthScale = speciesWidthScale[species];
+
 	// rotating the vertex about the blade centre. The angle pos.w is a random value from the application.
 	float angle = 2*M_PI*pos.w;
-	float newX = centrePos.x + cos(angle)*(pos.x - centrePos.x) - sin(angle)*(pos.z - centrePos.z);
-	float newZ = centrePos.z + sin(angle)*(pos.x - centrePos.x) + cos(angle)*(pos.z - centrePos.z);
+	float dx = widthScale*(pos.x - centrePos.x);
+	float dz = widthScale*(pos.z - centrePos.z);
+	float newX = centrePos.x + cos(angle)*dx - sin(angle)*dz;
+	float newZ = centrePos.z + sin(angle)*dx + cos(angle)*dz;
 
-	newPos = vec3(newX, pos.y, newZ);
+	// every vertex of the blade is lifted by the height under its root, so the blade stays upright on slopes
+	float rootHeight = terrainHeight(vec3(centrePos.x, 0.0, centrePos.z));
+	newPos = vec3(newX, pos.y*speciesHeightScale[species] + rootHeight, newZ);
 
 	// offset the upper vertices of a blade
-	float maxBending = 0.03;
+	float maxBending = 0.03*speciesBendingScale[species];
 	vec3 offset = vec3(maxBending*(2*texturePos.z - 1.0), 0.0, maxBending*(2*texturePos.w - 1.0));
 
-	vCentrePos = vec4((objectTransform * vec4(centrePos.xyz, 1)).xyz, centrePos.w);
+	vCentrePos = vec4((objectTransform * vec4(centrePos.x, centrePos.y + rootHeight, centrePos.z, 1)).xyz, centrePos.w);
 
 	if (windActive == 1)
 	{
@@ -48,13 +94,7 @@ void main()
 		offset.z += wind*0.16;
 	}
 
-	vec3 fieldWorldPos = vec3(patchPos.x, 0.0, patchPos.y) + (pos.xyz + vec3(0.5, 0.0, 0.5));
-	vec3 fieldRelativePos = fieldWorldPos - fieldRect[0];
-	vec3 fieldDimensions = fieldRect[1] - fieldRect[0];
-
-	vec2 mapPos = vec2(fieldRelativePos.x / fieldDimensions.x, fieldRelativePos.z / fieldDimensions.z);
-
-	vec4 force = texture(forceMap, mapPos)*2 - vec4(1.0, 1.0, 1.0, 0.0);
+	vec4 force = texture(forceMap, fieldMapPos(pos.xyz))*2 - vec4(1.0, 1.0, 1.0, 0.0);
 	vec3 forceOffset = force.xyz;
 
 	newPos += centrePos.y*offset;
@@ -65,4 +105,5 @@ void main()
 	vPos = newPos;
 	vTexturePos = texturePos.xy;
 	vRandom = random;
+	vSpecies = species;
 }
\ No newline at end of file
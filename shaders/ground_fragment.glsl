@@ -1,8 +1,15 @@
 #version 400 core
 
+in vec3 vWorldPos;
+
 out vec4 colour;
 
 void main()
 {
-	colour = vec4(70.0/255.0, 150.0/255.0, 77.0/255.0, 1.0f);
-}
\ No newline at end of file
+	// the terrain is only a height field so the normal from the screen space derivatives is good enough, and
+	// flat ground keeps exactly the colour it always had
+	vec3 normal = normalize(cross(dFdx(vWorldPos), dFdy(vWorldPos)));
+	float slopeShade = mix(0.6, 1.0, abs(normal.y));
+
+	colour = vec4(slopeShade*vec3(70.0/255.0, 150.0/255.0, 77.0/255.0), 1.0f);
+}
@@ -1,12 +1,40 @@
 #version 400 core
 
+// y is 0 for the surface and -1 for the skirt hanging under the patch's edges
 in vec3 pos;
 
+out vec3 vWorldPos;
+
 uniform mat4 object;
 uniform mat4 view;
 uniform mat4 projection;
 
+uniform vec2 patchPos;
+uniform vec3 fieldRect[2];
+uniform sampler2D heightMap;
+uniform float heightScale;
+// deep enough to hide the cracks where a patch meets a neighbour drawn at a coarser level of detail
+uniform float skirtDepth;
+
+// the grass vertex shader samples the height in the same way so the blades stand on the ground
+float terrainHeight(vec3 patchRelativePos)
+{
+	vec3 fieldWorldPos = vec3(patchPos.x, 0.0, patchPos.y) + (patchRelativePos + vec3(0.5, 0.0, 0.5));
+	vec3 fieldRelativePos = fieldWorldPos - fieldRect[0];
+	vec3 fieldDimensions = fieldRect[1] - fieldRect[0];
+
+	vec2 mapPos = vec2(fieldRelativePos.x / fieldDimensions.x, fieldRelativePos.z / fieldDimensions.z);
+	return texture(heightMap, mapPos).r*heightScale;
+}
+
 void main()
 {
-	gl_Position = projection * view * object * vec4(pos, 1.0f);
-}
\ No newline at end of file
+	vec3 surfacePos = vec3(pos.x, terrainHeight(vec3(pos.x, 0.0, pos.z)), pos.z);
+	if (pos.y < 0.0)
+		surfacePos.y -= skirtDepth;
+
+	vec4 worldPos = object * vec4(surfacePos, 1.0f);
+	vWorldPos = worldPos.xyz;
+
+	gl_Position = projection * view * worldPos;
+}
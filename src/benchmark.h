@@ -0,0 +1,182 @@
+#if !defined(BENCHMARK_H_)
+#define BENCHMARK_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// the benchmark feeds a scripted Input stream to appUpdate, so it exercises exactly the same code path
+// as an interactive session but is the same every run
+
+#define BENCHMARK_DEFAULT_FRAMES 600
+#define BENCHMARK_WIDTH 1280
+#define BENCHMARK_HEIGHT 720
+#define BENCHMARK_RANDOM_SEED 1234
+#define BENCHMARK_OUTPUT_FILE "benchmark_results.json"
+
+// every frame claims exactly this much time passed, so the simulation runs one step per frame
+#define BENCHMARK_TIMESTEP (1.0f/60.0f)
+
+// frames spent moving the camera into position, these are rendered but not measured
+#define BENCHMARK_SETUP_FRAMES 300
+#define BENCHMARK_ORBIT_PIXELS_PER_FRAME 2
+
+// GPU timer queries are read back this many frames late so that we never stall waiting on them
+#define BENCHMARK_QUERY_LATENCY 4
+
+// the report buffer is sized for this much per scenario (a scenario's object is about 600 characters plus its
+// force map's path) on top of the header and the closing brackets
+#define BENCHMARK_SCENARIO_REPORT_SIZE (KILOBYTE(1) + MAX_PATH)
+#define BENCHMARK_REPORT_HEADER_SIZE KILOBYTE(1)
+
+enum CameraPath
+{
+	CAMERA_PATH_NEAR_GROUND,
+	CAMERA_PATH_OVERHEAD,
+
+	CAMERA_PATH_COUNT
+};
+
+static char* _cameraPathNames[CAMERA_PATH_COUNT] = {"near_ground", "overhead"};
+
+static char* _benchmarkForceMaps[] = {
+	"default_force_map.png",
+	"force_map.png",
+	"force_map2.png",
+	"triforce_map.png"
+};
+
+struct BenchmarkScenario
+{
+	CameraPath cameraPath;
+	bool windActive;
+	char* forceMapFile;
+};
+
+struct TimingSummary
+{
+	f64 min;
+	f64 median;
+	f64 p99;
+};
+
+static inline u32 getBenchmarkScenarioCount()
+{
+	return CAMERA_PATH_COUNT*2*ARRAY_COUNT(_benchmarkForceMaps);
+}
+
+static BenchmarkScenario getBenchmarkScenario(u32 index)
+{
+	BenchmarkScenario result = {};
+
+	result.cameraPath = (CameraPath)(index % CAMERA_PATH_COUNT);
+	index /= CAMERA_PATH_COUNT;
+
+	result.windActive = (index % 2) == 1;
+	index /= 2;
+
+	result.forceMapFile = _benchmarkForceMaps[index];
+
+	return result;
+}
+
+// fills in the input the app receives on the given frame of the scenario
+static void getBenchmarkInput(BenchmarkScenario* scenario, u32 frame, Input* input)
+{
+	*input = {};
+	input->mouse.leftClickStartPos = V2(-1, -1);
+	input->mouse.rightClickStartPos = V2(-1, -1);
+	input->mouse.pos = V2(BENCHMARK_WIDTH/2, BENCHMARK_HEIGHT/2);
+
+	// wind is toggled when the action key is released, so hold it for the very first frame only
+	if (scenario->windActive && frame == 0)
+		input->controller.actionPressed = true;
+
+	if (frame < BENCHMARK_SETUP_FRAMES)
+	{
+		// the camera height is clamped by the app so we can just hold the key for the whole setup
+		if (scenario->cameraPath == CAMERA_PATH_NEAR_GROUND)
+			input->controller.downPressed = true;
+		else if (scenario->cameraPath == CAMERA_PATH_OVERHEAD)
+			input->controller.upPressed = true;
+	}
+	else
+	{
+		// orbit the field by dragging horizontally with the right mouse button
+		s32 orbitFrame = (s32)(frame - BENCHMARK_SETUP_FRAMES);
+		input->mouse.pos.x += orbitFrame*BENCHMARK_ORBIT_PIXELS_PER_FRAME;
+		input->mouse.rightPressed = true;
+		input->mouse.rightClickStartPos = V2(BENCHMARK_WIDTH/2, BENCHMARK_HEIGHT/2);
+	}
+}
+
+static int compareF64(const void* a, const void* b)
+{
+	f64 left = *(f64*)a;
+	f64 right = *(f64*)b;
+	return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+//NOTE(denis): sorts the timings in place
+static TimingSummary summarizeTimings(f64* timings, u32 count)
+{
+	TimingSummary result = {};
+
+	if (count > 0)
+	{
+		qsort(timings, count, sizeof(f64), compareF64);
+
+		result.min = timings[0];
+		result.median = timings[count/2];
+
+		u32 p99Index = (u32)((f64)count*0.99);
+		if (p99Index >= count)
+			p99Index = count - 1;
+		result.p99 = timings[p99Index];
+	}
+
+	return result;
+}
+
+// appends the JSON object for one scenario to the report buffer, returns the number of characters written or 0 if
+// it didn't fit, in which case the report is unusable.
+// cpuMs is only appUpdate, which submits the frame's GPU work without waiting for it, frameMs is from the start of
+// one frame to the start of the next and so includes the driver blocking on the GPU
+static u32 writeScenarioReport(char* buffer, u32 bufferSize, BenchmarkScenario* scenario, bool first,
+							   TimingSummary cpuMs, TimingSummary gpuMs, TimingSummary frameMs,
+							   f64 averageBladesSubmitted,
+							   FrameStats* lastFrameStats, u64 workingSetBytes)
+{
+	s32 written = snprintf(buffer, bufferSize,
+						   "%s\n\t\t{\n"
+						   "\t\t\t\"camera\": \"%s\",\n"
+						   "\t\t\t\"wind\": %s,\n"
+						   "\t\t\t\"forceMap\": \"%s\",\n"
+						   "\t\t\t\"cpuMs\": {\"min\": %.4f, \"median\": %.4f, \"p99\": %.4f},\n"
+						   "\t\t\t\"gpuMs\": {\"min\": %.4f, \"median\": %.4f, \"p99\": %.4f},\n"
+						   "\t\t\t\"frameMs\": {\"min\": %.4f, \"median\": %.4f, \"p99\": %.4f},\n"
+						   "\t\t\t\"bladesSubmitted\": %.1f,\n"
+						   "\t\t\t\"drawCalls\": %u,\n"
+						   "\t\t\t\"gpuMemoryBytes\": %llu,\n"
+						   "\t\t\t\"arenaPeakBytes\": %llu,\n"
+						   "\t\t\t\"workingSetBytes\": %llu\n"
+						   "\t\t}",
+						   first ? "" : ",",
+						   _cameraPathNames[scenario->cameraPath],
+						   scenario->windActive ? "true" : "false",
+						   scenario->forceMapFile,
+						   cpuMs.min, cpuMs.median, cpuMs.p99,
+						   gpuMs.min, gpuMs.median, gpuMs.p99,
+						   frameMs.min, frameMs.median, frameMs.p99,
+						   averageBladesSubmitted,
+						   lastFrameStats->drawCalls,
+						   (unsigned long long)lastFrameStats->gpuMemoryBytes,
+						   (unsigned long long)lastFrameStats->arenaPeakBytes,
+						   (unsigned long long)workingSetBytes);
+
+	if (written < 0 || (u32)written >= bufferSize)
+		written = 0;
+
+	return (u32)written;
+}
+
+#endif
@@ -10,6 +10,20 @@ mkdir ..\build 2> NUL
 
 pushd ..\build\
 
-cl %flags% %includes% ..\src\main.cpp /Fe%exe_file_name% /link %linker_flags% user32.lib gdi32.lib opengl32.lib
+cl %flags% %includes% ..\src\main.cpp /Fe%exe_file_name% /link %linker_flags% user32.lib gdi32.lib opengl32.lib psapi.lib winmm.lib
+
+cl %flags% %includes% ..\src\texture_converter.cpp /Fetexture_converter.exe /link %linker_flags%
+
+popd
+
+REM preprocessing the textures so the app doesn't have to decode them at startup
+pushd ..\data\
+
+..\build\texture_converter.exe grass_alpha_texture.png -bc4 -mask
+..\build\texture_converter.exe leaf_alpha_texture.png -bc4 -mask
+..\build\texture_converter.exe grass_diffuse_texture.jpg -bc1
+..\build\texture_converter.exe terrain_heightmap.png -r8 -nomips
+..\build\texture_converter.exe vegetation_map.png -r8 -nomips
+for %%f in (default_force_map.png force_map.png force_map2.png triforce_map.png) do ..\build\texture_converter.exe %%f -rgba8 -nomips
 
 popd
@@ -549,6 +549,15 @@ static inline v4f operator/(v4f left, f32 scalar)
 	result.w = left.w / scalar;
 	return result;
 }
+static inline v4f operator*(v4f left, f32 scalar)
+{
+	v4f result;
+	result.x = left.x * scalar;
+	result.y = left.y * scalar;
+	result.z = left.z * scalar;
+	result.w = left.w * scalar;
+	return result;
+}
 
 //--------------------------------------------------------------------------
 // Matrix Helper Functions
@@ -0,0 +1,105 @@
+#if !defined(DENIS_MEMORY_H_)
+#define DENIS_MEMORY_H_
+
+#include "denis_types.h"
+
+//NOTE(denis): an arena is a linear allocator over memory somebody else owns. Nothing is freed on its own,
+// everything pushed after beginTemporaryMemory goes away together at endTemporaryMemory (or clearArena).
+// An arena must only be used by one thread at a time, give every job its own sub arena instead.
+
+#define ARENA_DEFAULT_ALIGNMENT 16
+
+struct MemoryArena
+{
+	u8* base;
+	u64 size;
+	u64 used;
+
+	// the most that has ever been in use, this is what the arena really needs to be sized for
+	u64 peakUsed;
+	u32 temporaryCount;
+};
+
+struct TemporaryMemory
+{
+	MemoryArena* arena;
+	u64 used;
+};
+
+static inline void initArena(MemoryArena* arena, void* base, u64 size)
+{
+	*arena = {};
+	arena->base = (u8*)base;
+	arena->size = size;
+}
+
+// returns 0 if the arena doesn't have room, the memory is not cleared. This is for callers that have a fallback
+// when the memory isn't there, everything else should use pushSize
+static void* tryPushSize(MemoryArena* arena, u64 size, u64 alignment = ARENA_DEFAULT_ALIGNMENT)
+{
+	u64 address = (u64)(arena->base + arena->used);
+	u64 alignmentOffset = (alignment - (address & (alignment - 1))) & (alignment - 1);
+
+	if (arena->used + alignmentOffset + size > arena->size)
+		return 0;
+
+	void* result = arena->base + arena->used + alignmentOffset;
+	arena->used += alignmentOffset + size;
+	if (arena->used > arena->peakUsed)
+		arena->peakUsed = arena->used;
+
+	return result;
+}
+
+// same as tryPushSize, but running out of room is a bug so it asserts
+static void* pushSize(MemoryArena* arena, u64 size, u64 alignment = ARENA_DEFAULT_ALIGNMENT)
+{
+	void* result = tryPushSize(arena, size, alignment);
+	ASSERT(result && "memory arena is full");
+
+	return result;
+}
+
+#define PUSH_STRUCT(arena, type) (type*)pushSize(arena, sizeof(type))
+#define PUSH_ARRAY(arena, count, type) (type*)pushSize(arena, (count)*sizeof(type))
+#define TRY_PUSH_ARRAY(arena, count, type) (type*)tryPushSize(arena, (count)*sizeof(type))
+
+// carves a separate arena out of the parent, which is how a job gets memory it can use without locking
+static MemoryArena pushSubArena(MemoryArena* parent, u64 size)
+{
+	MemoryArena result;
+	initArena(&result, pushSize(parent, size), size);
+	if (!result.base)
+		result.size = 0;
+
+	return result;
+}
+
+static inline TemporaryMemory beginTemporaryMemory(MemoryArena* arena)
+{
+	TemporaryMemory result;
+	result.arena = arena;
+	result.used = arena->used;
+
+	++arena->temporaryCount;
+
+	return result;
+}
+
+static inline void endTemporaryMemory(TemporaryMemory temporaryMemory)
+{
+	MemoryArena* arena = temporaryMemory.arena;
+	ASSERT(arena->used >= temporaryMemory.used);
+	ASSERT(arena->temporaryCount > 0);
+
+	arena->used = temporaryMemory.used;
+	--arena->temporaryCount;
+}
+
+static inline void clearArena(MemoryArena* arena)
+{
+	ASSERT(arena->temporaryCount == 0);
+	arena->used = 0;
+}
+
+#endif
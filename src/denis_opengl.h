@@ -12,6 +12,13 @@
 #define GL_TESS_EVALUATION_SHADER         0x8E87
 #define GL_TESS_CONTROL_SHADER            0x8E88
 #define GL_COMPILE_STATUS				  0x8B81
+#define GL_LINK_STATUS                    0x8B82
+#define GL_INFO_LOG_LENGTH                0x8B84
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH          0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS     0x87FE
+#define GL_NUM_EXTENSIONS                 0x821D
+#define GL_COMPLETION_STATUS              0x91B1
 #define GL_PATCHES                        0x000E
 #define GL_PATCH_VERTICES                 0x8E72
 #define GL_PATCH_DEFAULT_INNER_LEVEL      0x8E73
@@ -23,6 +30,49 @@
 #define GL_TEXTURE4                       0x84C4
 #define GL_TEXTURE5                       0x84C5
 #define GL_CLAMP_TO_EDGE                  0x812F
+#define GL_RGBA8                          0x8058
+#define GL_R8                             0x8229
+#define GL_DEPTH_COMPONENT24              0x81A6
+#define GL_FRAMEBUFFER                    0x8D40
+#define GL_RENDERBUFFER                   0x8D41
+#define GL_READ_FRAMEBUFFER               0x8CA8
+#define GL_DRAW_FRAMEBUFFER               0x8CA9
+#define GL_COLOR_ATTACHMENT0              0x8CE0
+#define GL_DEPTH_ATTACHMENT               0x8D00
+#define GL_FRAMEBUFFER_COMPLETE           0x8CD5
+#define GL_QUERY_RESULT                   0x8866
+#define GL_QUERY_RESULT_AVAILABLE         0x8867
+#define GL_TIME_ELAPSED                   0x88BF
+#define GL_DRAW_FRAMEBUFFER_BINDING       0x8CA6
+#define GL_MAX_SAMPLES                    0x8D57
+#define GL_SAMPLE_ALPHA_TO_COVERAGE       0x809E
+#define GL_TEXTURE_MAX_LEVEL              0x813D
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT     0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT   0x83F0
+#define GL_COMPRESSED_RED_RGTC1           0x8DBB
+#define GL_COMPRESSED_RG_RGTC2            0x8DBD
+#define GL_TEXTURE_2D_ARRAY               0x8C1A
+#define GL_COPY_READ_BUFFER               0x8F36
+#define GL_COPY_WRITE_BUFFER              0x8F37
+#define GL_MAP_READ_BIT                   0x0001
+#define GL_MAP_WRITE_BIT                  0x0002
+#define GL_MAP_PERSISTENT_BIT             0x0040
+#define GL_MAP_COHERENT_BIT               0x0080
+#define GL_SYNC_GPU_COMMANDS_COMPLETE     0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT        0x00000001
+#define GL_TIMEOUT_EXPIRED                0x911B
+#define GL_PIXEL_PACK_BUFFER              0x88EB
+#define GL_STREAM_READ                    0x88E1
+#define GL_TRANSFORM_FEEDBACK_BUFFER      0x8C8E
+#define GL_INTERLEAVED_ATTRIBS            0x8C8C
+#define GL_RASTERIZER_DISCARD             0x8C89
+#define GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN 0x8C88
+
+// types that aren't in the gl.h shipped with Windows
+typedef ptrdiff_t GLintptr;
+typedef ptrdiff_t GLsizeiptr;
+typedef struct __GLsync* GLsync;
 
 //NOTE(denis): functions used that are already part of Windows:
 // - glDrawArrays
@@ -33,7 +83,7 @@ typedef void(*GL_GEN_BUFFERS_PTR)(u32, u32*);
 typedef void(*GL_BIND_BUFFER_PTR)(GLenum, u32);
 typedef void(*GL_BUFFER_DATA_PTR)(GLenum, u32, void*, GLenum);
 typedef u32(*GL_CREATE_SHADER_PTR)(GLenum);
-typedef void(*GL_SHADER_SOURCE_PTR)(u32, u32, const char**, const s32**);
+typedef void(*GL_SHADER_SOURCE_PTR)(u32, u32, const char**, const s32*);
 typedef void(*GL_COMPILE_SHADER_PTR)(u32);
 typedef void(*GL_GET_SHADER_IV_PTR)(u32, GLenum, s32*);
 typedef void(*GL_GET_SHADER_INFO_LOG_PTR)(u32, u32, u32*, char*);
@@ -47,16 +97,60 @@ typedef void(*GL_ENABLE_VERTEX_ATTRIB_ARRAY_PTR)(u32);
 typedef void(*GL_GEN_VERTEX_ARRAYS_PTR)(u32, u32*);
 typedef void(*GL_BIND_VERTEX_ARRAY_PTR)(u32);
 typedef void(*GL_POLYGON_MODE_PTR)(GLenum, GLenum);
-typedef void(*GL_BUFFER_SUB_DATA_PTR)(GLenum, s32*, u32*, const void*);
+typedef void(*GL_BUFFER_SUB_DATA_PTR)(GLenum, GLintptr, GLsizeiptr, const void*);
 typedef s32(*GL_GET_UNIFORM_LOCATION_PTR)(u32, const char*);
 typedef void(*GL_UNIFORM_1F_PTR)(s32, f32);
 typedef void(*GL_UNIFORM_1I_PTR)(s32, s32);
 typedef void(*GL_UNIFORM_2IV_PTR)(s32, s32, s32*);
 typedef void(*GL_UNIFORM_2FV_PTR)(s32, s32, f32*);
 typedef void(*GL_UNIFORM_3FV_PTR)(s32, s32, f32*);
+typedef void(*GL_UNIFORM_1IV_PTR)(s32, s32, s32*);
+typedef void(*GL_UNIFORM_1FV_PTR)(s32, s32, f32*);
 typedef void(*GL_UNIFORM_MATRIX4FV_PTR)(s32, u32, GLboolean, const f32*);
 typedef void(*GL_PATCH_PARAMETERI_PTR)(GLenum, s32);
 typedef void(*GL_ACTIVE_TEXTURE_PTR)(GLenum);
+typedef void(*GL_GEN_FRAMEBUFFERS_PTR)(u32, u32*);
+typedef void(*GL_DELETE_FRAMEBUFFERS_PTR)(u32, u32*);
+typedef void(*GL_BIND_FRAMEBUFFER_PTR)(GLenum, u32);
+typedef GLenum(*GL_CHECK_FRAMEBUFFER_STATUS_PTR)(GLenum);
+typedef void(*GL_FRAMEBUFFER_RENDERBUFFER_PTR)(GLenum, GLenum, GLenum, u32);
+typedef void(*GL_GEN_RENDERBUFFERS_PTR)(u32, u32*);
+typedef void(*GL_DELETE_RENDERBUFFERS_PTR)(u32, u32*);
+typedef void(*GL_BIND_RENDERBUFFER_PTR)(GLenum, u32);
+typedef void(*GL_RENDERBUFFER_STORAGE_PTR)(GLenum, GLenum, u32, u32);
+typedef void(*GL_RENDERBUFFER_STORAGE_MULTISAMPLE_PTR)(GLenum, u32, GLenum, u32, u32);
+typedef void(*GL_BLIT_FRAMEBUFFER_PTR)(s32, s32, s32, s32, s32, s32, s32, s32, GLbitfield, GLenum);
+typedef void(*GL_GEN_QUERIES_PTR)(u32, u32*);
+typedef void(*GL_DELETE_QUERIES_PTR)(u32, u32*);
+typedef void(*GL_BEGIN_QUERY_PTR)(GLenum, u32);
+typedef void(*GL_END_QUERY_PTR)(GLenum);
+typedef void(*GL_GET_QUERY_OBJECT_UI64V_PTR)(u32, GLenum, u64*);
+typedef void(*GL_GET_PROGRAM_IV_PTR)(u32, GLenum, s32*);
+typedef void(*GL_GET_PROGRAM_INFO_LOG_PTR)(u32, u32, u32*, char*);
+typedef void(*GL_DELETE_PROGRAM_PTR)(u32);
+typedef void(*GL_GET_PROGRAM_BINARY_PTR)(u32, u32, u32*, GLenum*, void*);
+typedef void(*GL_PROGRAM_BINARY_PTR)(u32, GLenum, const void*, u32);
+typedef void(*GL_PROGRAM_PARAMETERI_PTR)(u32, GLenum, s32);
+typedef const GLubyte*(*GL_GET_STRINGI_PTR)(GLenum, u32);
+typedef void(*GL_MAX_SHADER_COMPILER_THREADS_PTR)(u32);
+typedef void(*GL_GENERATE_MIPMAP_PTR)(GLenum);
+typedef void(*GL_COMPRESSED_TEX_IMAGE_2D_PTR)(GLenum, s32, GLenum, s32, s32, s32, s32, const void*);
+typedef void(*GL_TEX_IMAGE_3D_PTR)(GLenum, s32, s32, s32, s32, s32, s32, GLenum, GLenum, const void*);
+typedef void(*GL_TEX_SUB_IMAGE_3D_PTR)(GLenum, s32, s32, s32, s32, s32, s32, s32, GLenum, GLenum, const void*);
+typedef void(*GL_COMPRESSED_TEX_IMAGE_3D_PTR)(GLenum, s32, GLenum, s32, s32, s32, s32, s32, const void*);
+typedef void(*GL_COMPRESSED_TEX_SUB_IMAGE_3D_PTR)(GLenum, s32, s32, s32, s32, s32, s32, s32, GLenum, s32, const void*);
+typedef void(*GL_BUFFER_STORAGE_PTR)(GLenum, GLsizeiptr, const void*, GLbitfield);
+typedef void*(*GL_MAP_BUFFER_RANGE_PTR)(GLenum, GLintptr, GLsizeiptr, GLbitfield);
+typedef void(*GL_COPY_BUFFER_SUB_DATA_PTR)(GLenum, GLenum, GLintptr, GLintptr, GLsizeiptr);
+typedef GLsync(*GL_FENCE_SYNC_PTR)(GLenum, GLbitfield);
+typedef GLenum(*GL_CLIENT_WAIT_SYNC_PTR)(GLsync, GLbitfield, u64);
+typedef void(*GL_DELETE_SYNC_PTR)(GLsync);
+typedef GLboolean(*GL_UNMAP_BUFFER_PTR)(GLenum);
+typedef void(*GL_DELETE_BUFFERS_PTR)(u32, u32*);
+typedef void(*GL_TRANSFORM_FEEDBACK_VARYINGS_PTR)(u32, s32, const char* const*, GLenum);
+typedef void(*GL_BIND_BUFFER_BASE_PTR)(GLenum, u32, u32);
+typedef void(*GL_BEGIN_TRANSFORM_FEEDBACK_PTR)(GLenum);
+typedef void(*GL_END_TRANSFORM_FEEDBACK_PTR)(void);
 
 GL_GEN_BUFFERS_PTR glGenBuffers = 0;
 GL_BIND_BUFFER_PTR glBindBuffer = 0;
@@ -82,9 +176,72 @@ GL_UNIFORM_1I_PTR glUniform1i = 0;
 GL_UNIFORM_2IV_PTR glUniform2iv = 0;
 GL_UNIFORM_2FV_PTR glUniform2fv = 0;
 GL_UNIFORM_3FV_PTR glUniform3fv = 0;
+GL_UNIFORM_1IV_PTR glUniform1iv = 0;
+GL_UNIFORM_1FV_PTR glUniform1fv = 0;
 GL_UNIFORM_MATRIX4FV_PTR glUniformMatrix4fv = 0;
 GL_PATCH_PARAMETERI_PTR glPatchParameteri = 0;
 GL_ACTIVE_TEXTURE_PTR glActiveTexture = 0;
+GL_GEN_FRAMEBUFFERS_PTR glGenFramebuffers = 0;
+GL_DELETE_FRAMEBUFFERS_PTR glDeleteFramebuffers = 0;
+GL_BIND_FRAMEBUFFER_PTR glBindFramebuffer = 0;
+GL_CHECK_FRAMEBUFFER_STATUS_PTR glCheckFramebufferStatus = 0;
+GL_FRAMEBUFFER_RENDERBUFFER_PTR glFramebufferRenderbuffer = 0;
+GL_GEN_RENDERBUFFERS_PTR glGenRenderbuffers = 0;
+GL_DELETE_RENDERBUFFERS_PTR glDeleteRenderbuffers = 0;
+GL_BIND_RENDERBUFFER_PTR glBindRenderbuffer = 0;
+GL_RENDERBUFFER_STORAGE_PTR glRenderbufferStorage = 0;
+GL_RENDERBUFFER_STORAGE_MULTISAMPLE_PTR glRenderbufferStorageMultisample = 0;
+GL_BLIT_FRAMEBUFFER_PTR glBlitFramebuffer = 0;
+GL_GEN_QUERIES_PTR glGenQueries = 0;
+GL_DELETE_QUERIES_PTR glDeleteQueries = 0;
+GL_BEGIN_QUERY_PTR glBeginQuery = 0;
+GL_END_QUERY_PTR glEndQuery = 0;
+GL_GET_QUERY_OBJECT_UI64V_PTR glGetQueryObjectui64v = 0;
+GL_GET_PROGRAM_IV_PTR glGetProgramiv = 0;
+GL_GET_PROGRAM_INFO_LOG_PTR glGetProgramInfoLog = 0;
+GL_DELETE_PROGRAM_PTR glDeleteProgram = 0;
+GL_GET_PROGRAM_BINARY_PTR glGetProgramBinary = 0;
+GL_PROGRAM_BINARY_PTR glProgramBinary = 0;
+GL_PROGRAM_PARAMETERI_PTR glProgramParameteri = 0;
+GL_GET_STRINGI_PTR glGetStringi = 0;
+GL_MAX_SHADER_COMPILER_THREADS_PTR glMaxShaderCompilerThreads = 0;
+GL_GENERATE_MIPMAP_PTR glGenerateMipmap = 0;
+GL_COMPRESSED_TEX_IMAGE_2D_PTR glCompressedTexImage2D = 0;
+GL_TEX_IMAGE_3D_PTR glTexImage3D = 0;
+GL_TEX_SUB_IMAGE_3D_PTR glTexSubImage3D = 0;
+GL_COMPRESSED_TEX_IMAGE_3D_PTR glCompressedTexImage3D = 0;
+GL_COMPRESSED_TEX_SUB_IMAGE_3D_PTR glCompressedTexSubImage3D = 0;
+GL_BUFFER_STORAGE_PTR glBufferStorage = 0;
+GL_MAP_BUFFER_RANGE_PTR glMapBufferRange = 0;
+GL_COPY_BUFFER_SUB_DATA_PTR glCopyBufferSubData = 0;
+GL_FENCE_SYNC_PTR glFenceSync = 0;
+GL_CLIENT_WAIT_SYNC_PTR glClientWaitSync = 0;
+GL_DELETE_SYNC_PTR glDeleteSync = 0;
+GL_UNMAP_BUFFER_PTR glUnmapBuffer = 0;
+GL_DELETE_BUFFERS_PTR glDeleteBuffers = 0;
+GL_TRANSFORM_FEEDBACK_VARYINGS_PTR glTransformFeedbackVaryings = 0;
+GL_BIND_BUFFER_BASE_PTR glBindBufferBase = 0;
+GL_BEGIN_TRANSFORM_FEEDBACK_PTR glBeginTransformFeedback = 0;
+GL_END_TRANSFORM_FEEDBACK_PTR glEndTransformFeedback = 0;
+
+// set by enableParallelShaderCompile when the driver supports GL_COMPLETION_STATUS
+static bool _parallelShaderCompile = false;
+
+#define SHADER_STAGE_COUNT 4
+static GLenum _shaderStageTypes[SHADER_STAGE_COUNT] = {
+	GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER
+};
+
+struct Framebuffer
+{
+	u32 id;
+	u32 colourBuffer;
+	u32 depthBuffer;
+
+	u32 width;
+	u32 height;
+	u32 samples;
+};
 
 static u32 createVertexBuffer(void* vertices, u32 numVertices, u32 vertexSize)
 {
@@ -129,86 +286,503 @@ static u32 createElementBuffer(v3* faces, u32 numFaces)
 	return bufferResult;
 }
 
-static u32 compileShader(void* shaderData, GLenum shaderType)
+// creates an offscreen colour + depth target, the returned id is 0 if the framebuffer is incomplete.
+// A multisampled framebuffer can't be read from directly, it has to be resolved with glBlitFramebuffer
+static Framebuffer createFramebuffer(u32 width, u32 height, u32 samples = 0)
 {
-	u32 shaderObject = 0;
-	
-	const char* shaderString = (char*)shaderData;
-	shaderObject = glCreateShader(shaderType);
-	glShaderSource(shaderObject, 1, &shaderString, 0);
-	glCompileShader(shaderObject);
+	Framebuffer result = {};
+	result.width = width;
+	result.height = height;
+	result.samples = samples;
+
+	glGenFramebuffers(1, &result.id);
+	glBindFramebuffer(GL_FRAMEBUFFER, result.id);
+
+	glGenRenderbuffers(1, &result.colourBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, result.colourBuffer);
+	if (samples > 1)
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+	else
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, result.colourBuffer);
+
+	glGenRenderbuffers(1, &result.depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, result.depthBuffer);
+	if (samples > 1)
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+	else
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, result.depthBuffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		glDeleteFramebuffers(1, &result.id);
+		glDeleteRenderbuffers(1, &result.colourBuffer);
+		glDeleteRenderbuffers(1, &result.depthBuffer);
+		result = {};
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	return result;
+}
+
+static void deleteFramebuffer(Framebuffer* framebuffer)
+{
+	// deleting 0 is silently ignored, so this is fine on a framebuffer that was never created
+	glDeleteFramebuffers(1, &framebuffer->id);
+	glDeleteRenderbuffers(1, &framebuffer->colourBuffer);
+	glDeleteRenderbuffers(1, &framebuffer->depthBuffer);
+
+	*framebuffer = {};
+}
+
+// a buffer that stays mapped for as long as it lives, split into regions that are written one frame each. The GPU
+// only reads a region after it's been written (with glCopyBufferSubData), and a fence stops the CPU writing it
+// again before the GPU has finished with it
+#define STREAM_BUFFER_REGION_COUNT 3
+// how long to wait on a fence (in nanoseconds) before checking again
+#define STREAM_BUFFER_WAIT_TIMEOUT 1000000
+
+struct StreamBuffer
+{
+	u32 buffer;
+	u8* mapped;
+
+	u32 regionSize;
+	u32 currentRegion;
+	GLsync fences[STREAM_BUFFER_REGION_COUNT];
+};
+
+// returns false and leaves the stream unmapped when the driver doesn't have glBufferStorage (core in 4.4)
+static bool createStreamBuffer(StreamBuffer* stream, u32 regionSize)
+{
+	*stream = {};
+
+	if (!glBufferStorage)
+		return false;
+
+	u32 size = regionSize*STREAM_BUFFER_REGION_COUNT;
+	//NOTE(denis): coherent so the writes from the worker threads don't need to be flushed by hand
+	GLbitfield flags = GL_MAP_WRITE_BIT|GL_MAP_PERSISTENT_BIT|GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &stream->buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, size, 0, flags);
+	stream->mapped = (u8*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
 
-	s32 success;
-	glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &success);
-	if (!success)
+	if (!stream->mapped)
+		return false;
+
+	stream->regionSize = regionSize;
+
+	return true;
+}
+
+// returns where this frame's region is mapped once the GPU is done with it, or 0 if the stream isn't mapped.
+// Any thread can write into the region, but only the GL thread can begin and end it
+static u8* beginStreamRegion(StreamBuffer* stream)
+{
+	if (!stream->mapped)
+		return 0;
+
+	GLsync fence = stream->fences[stream->currentRegion];
+	if (fence)
 	{
-		char infoLog[512] = {};
-		glGetShaderInfoLog(shaderObject, 512, NULL, infoLog);
+		// the region was last used STREAM_BUFFER_REGION_COUNT frames ago, so this should hardly ever wait
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, STREAM_BUFFER_WAIT_TIMEOUT) == GL_TIMEOUT_EXPIRED)
+		{
+		}
+
+		glDeleteSync(fence);
+		stream->fences[stream->currentRegion] = 0;
+	}
+
+	return stream->mapped + stream->currentRegion*stream->regionSize;
+}
+
+static inline u32 getStreamRegionOffset(StreamBuffer* stream)
+{
+	return stream->currentRegion*stream->regionSize;
+}
+
+// fences every command that reads from the region since beginStreamRegion and moves on to the next one
+static void endStreamRegion(StreamBuffer* stream)
+{
+	if (!stream->mapped)
+		return;
+
+	stream->fences[stream->currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	stream->currentRegion = (stream->currentRegion + 1) % STREAM_BUFFER_REGION_COUNT;
+}
 
-		ASSERT(!infoLog);
-		
-		glDeleteShader(shaderObject);
-		shaderObject = 0;
+#define PROGRAM_CACHE_MAGIC 0x48434750 // "PGCH"
+#define PROGRAM_CACHE_VERSION 1
+
+// a cached program binary on disk is this header followed by binaryLength bytes of the driver's binary
+struct ProgramCacheHeader
+{
+	u32 magic;
+	u32 version;
+
+	// hash of every shader source and the driver strings, if anything changes the binary is stale
+	u64 key;
+
+	u32 binaryFormat;
+	u32 binaryLength;
+};
+
+#define HASH_SEED 0xcbf29ce484222325
+
+// FNV-1a, pass the result of a previous call as hash to keep hashing more data
+static u64 hashBytes(void* data, u64 size, u64 hash = HASH_SEED)
+{
+	u8* bytes = (u8*)data;
+	for (u64 i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3;
 	}
 
-	return shaderObject;
+	return hash;
+}
+
+static inline u64 hashString(char* string, u64 hash)
+{
+	if (string)
+		hash = hashBytes(string, getStringSize(string), hash);
+
+	return hash;
+}
+
+static bool programBinariesSupported()
+{
+	if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+		return false;
+
+	s32 numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	return numFormats > 0;
 }
 
-// returns the shader program associated with the two shaders given
-static u32 initShaders(Platform platform, char* vertexFile, char* fragmentFile, char* tcsFile, char* tesFile)
+// returns the linked program or 0 if the cache data is stale or the driver rejects the binary
+static u32 createProgramFromCache(void* cacheData, u64 cacheSize, u64 key)
 {
-	u32 shaderProgram = glCreateProgram();
+	u32 program = 0;
 
-	u32 vertexShader = 0;
-	if (vertexFile)
+	ProgramCacheHeader* header = (ProgramCacheHeader*)cacheData;
+	if (cacheData && cacheSize >= sizeof(ProgramCacheHeader) &&
+		header->magic == PROGRAM_CACHE_MAGIC && header->version == PROGRAM_CACHE_VERSION &&
+		header->key == key && sizeof(ProgramCacheHeader) + header->binaryLength <= cacheSize)
 	{
-		void* vertexShaderData = platform.readFile(vertexFile);
-	    vertexShader = compileShader(vertexShaderData, GL_VERTEX_SHADER);
-		HEAP_FREE(vertexShaderData);
+		program = glCreateProgram();
+		glProgramBinary(program, header->binaryFormat, (u8*)cacheData + sizeof(ProgramCacheHeader),
+						header->binaryLength);
 
-		glAttachShader(shaderProgram, vertexShader);
+		//NOTE(denis): drivers are allowed to reject binaries for any reason, we silently fall back to compiling
+		s32 success;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glDeleteProgram(program);
+			program = 0;
+		}
 	}
 
-	u32 fragmentShader = 0;
-	if (fragmentFile)
+	return program;
+}
+
+// returns the linked program or 0 if the cache is missing, stale, or the driver rejects the binary
+static u32 loadCachedProgram(Platform platform, char* cacheFile, u64 key)
+{
+	u32 program = 0;
+
+	MappedFile cache;
+	if (platform.mapFile(cacheFile, &cache))
+		program = createProgramFromCache(cache.data, cache.size, key);
+
+	platform.unmapFile(&cache);
+
+	return program;
+}
+
+// the binary is only staged in the arena until it's written out
+static void saveCachedProgram(Platform platform, MemoryArena* arena, char* cacheFile, u64 key, u32 program)
+{
+	s32 binaryLength = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0)
+		return;
+
+	TemporaryMemory cacheMemory = beginTemporaryMemory(arena);
+
+	u32 cacheSize = sizeof(ProgramCacheHeader) + binaryLength;
+	u8* cacheData = TRY_PUSH_ARRAY(arena, cacheSize, u8);
+	if (!cacheData)
 	{
-		void* fragmentShaderData = platform.readFile(fragmentFile);
-	    fragmentShader = compileShader(fragmentShaderData, GL_FRAGMENT_SHADER);
-		HEAP_FREE(fragmentShaderData);
+		endTemporaryMemory(cacheMemory);
+		return;
+	}
+	
+	ProgramCacheHeader* header = (ProgramCacheHeader*)cacheData;
+	header->magic = PROGRAM_CACHE_MAGIC;
+	header->version = PROGRAM_CACHE_VERSION;
+	header->key = key;
+
+	GLenum binaryFormat = 0;
+	u32 lengthWritten = 0;
+	glGetProgramBinary(program, binaryLength, &lengthWritten, &binaryFormat, cacheData + sizeof(ProgramCacheHeader));
+	header->binaryFormat = binaryFormat;
+	header->binaryLength = lengthWritten;
 
-		glAttachShader(shaderProgram, fragmentShader);
+	if (lengthWritten > 0)
+		platform.writeFile(cacheFile, cacheData, sizeof(ProgramCacheHeader) + lengthWritten);
+
+	endTemporaryMemory(cacheMemory);
+}
+
+// an in-flight shader program build. When the driver compiles in parallel this can be started one frame and
+// finished on a later one without ever blocking the GL thread
+struct ProgramBuild
+{
+	u32 program;
+	u32 shaders[SHADER_STAGE_COUNT];
+	char* shaderFiles[SHADER_STAGE_COUNT];
+
+	char* cacheFile;
+	u64 cacheKey;
+};
+
+static bool hasGLExtension(char* extension)
+{
+	s32 numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+
+	for (s32 i = 0; i < numExtensions; ++i)
+	{
+		if (stringsEqual((char*)glGetStringi(GL_EXTENSIONS, i), extension))
+			return true;
 	}
 
-	u32 tcs = 0;
-	if (tcsFile)
+	return false;
+}
+
+// lets the driver compile and link on its own threads, must be called once per context
+static void enableParallelShaderCompile()
+{
+	_parallelShaderCompile = false;
+
+	if (hasGLExtension("GL_ARB_parallel_shader_compile") || hasGLExtension("GL_KHR_parallel_shader_compile"))
 	{
-		void* tcsData = platform.readFile(tcsFile);
-		tcs = compileShader(tcsData, GL_TESS_CONTROL_SHADER);
-		HEAP_FREE(tcsData);
+		if (glMaxShaderCompilerThreads)
+			glMaxShaderCompilerThreads(0xFFFFFFFF);
 
-		glAttachShader(shaderProgram, tcs);
+		_parallelShaderCompile = true;
 	}
+}
 
-	u32 tes = 0;
-	if (tesFile)
+// maps every given shader file, returns false if any of them could not be mapped. The sources have to be given
+// back with freeShaderSources either way
+static bool readShaderSources(Platform platform, char* shaderFiles[SHADER_STAGE_COUNT],
+							  MappedFile shaderSources[SHADER_STAGE_COUNT])
+{
+	bool success = true;
+
+	for (u32 i = 0; i < SHADER_STAGE_COUNT; ++i)
 	{
-		void* tesData = platform.readFile(tesFile);
-		tes = compileShader(tesData, GL_TESS_EVALUATION_SHADER);
-		HEAP_FREE(tesData);
+		shaderSources[i] = {};
+		if (shaderFiles[i])
+		{
+			if (!platform.mapFile(shaderFiles[i], &shaderSources[i]))
+			{
+				platform.debugOutput(shaderFiles[i]);
+				platform.debugOutput(" could not be read\n");
+				success = false;
+			}
+		}
+	}
+
+	return success;
+}
 
-		glAttachShader(shaderProgram, tes);
+static void freeShaderSources(Platform platform, MappedFile shaderSources[SHADER_STAGE_COUNT])
+{
+	for (u32 i = 0; i < SHADER_STAGE_COUNT; ++i)
+		platform.unmapFile(&shaderSources[i]);
+}
+
+// a binary only works on the driver that made it, so this goes into every cache key
+static u64 getDriverHash()
+{
+	u64 hash = hashString((char*)glGetString(GL_VENDOR), HASH_SEED);
+	hash = hashString((char*)glGetString(GL_RENDERER), hash);
+	hash = hashString((char*)glGetString(GL_VERSION), hash);
+
+	return hash;
+}
+
+//NOTE(denis): doesn't touch GL, so this can be done on any thread
+static u64 getProgramCacheKey(u64 driverHash, MappedFile shaderSources[SHADER_STAGE_COUNT])
+{
+	u64 key = driverHash;
+	for (u32 i = 0; i < SHADER_STAGE_COUNT; ++i)
+	{
+		// hashing the stage too so moving a file to a different stage changes the key
+		key = hashBytes(&_shaderStageTypes[i], sizeof(GLenum), key);
+		key = hashBytes(shaderSources[i].data, shaderSources[i].size, key);
 	}
 
-	//TODO(denis): check if this succeeded or failed
-	glLinkProgram(shaderProgram);
+	return key;
+}
 
-	glUseProgram(shaderProgram);
+// submits every shader and the link to the driver without waiting for any of it to finish,
+// the sources can be unmapped as soon as this returns. Any feedbackVaryings are captured interleaved, in the
+// order they're given, while transform feedback is active
+static void startProgramBuild(ProgramBuild* build, char* shaderFiles[SHADER_STAGE_COUNT],
+							  MappedFile shaderSources[SHADER_STAGE_COUNT], char* cacheFile, u64 cacheKey,
+							  char** feedbackVaryings = 0, u32 feedbackVaryingCount = 0)
+{
+	*build = {};
+	build->cacheFile = cacheFile;
+	build->cacheKey = cacheKey;
+
+	build->program = glCreateProgram();
+	if (cacheFile)
+		glProgramParameteri(build->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	for (u32 i = 0; i < SHADER_STAGE_COUNT; ++i)
+	{
+		build->shaderFiles[i] = shaderFiles[i];
+		if (shaderSources[i].data)
+		{
+			//NOTE(denis): a mapped file isn't 0 terminated, so the driver has to be given the length
+			const char* shaderString = (char*)shaderSources[i].data;
+			s32 shaderLength = (s32)shaderSources[i].size;
+			build->shaders[i] = glCreateShader(_shaderStageTypes[i]);
+			glShaderSource(build->shaders[i], 1, &shaderString, &shaderLength);
+			glCompileShader(build->shaders[i]);
+
+			glAttachShader(build->program, build->shaders[i]);
+		}
+	}
+
+	if (feedbackVaryingCount > 0)
+	{
+		glTransformFeedbackVaryings(build->program, (s32)feedbackVaryingCount, feedbackVaryings,
+									GL_INTERLEAVED_ATTRIBS);
+	}
+
+	glLinkProgram(build->program);
+}
+
+// true once finishProgramBuild can be called without blocking
+static bool programBuildReady(ProgramBuild* build)
+{
+	if (!_parallelShaderCompile)
+		return true;
+
+	s32 completed = 0;
+	glGetProgramiv(build->program, GL_COMPLETION_STATUS, &completed);
+	return completed != 0;
+}
+
+// returns the linked program, or 0 after reporting why it failed. The arena is only used while saving the binary
+static u32 finishProgramBuild(Platform platform, MemoryArena* arena, ProgramBuild* build)
+{
+	u32 program = build->program;
+
+	bool compiled = true;
+	for (u32 i = 0; i < SHADER_STAGE_COUNT; ++i)
+	{
+		if (!build->shaders[i])
+			continue;
+
+		s32 success;
+		glGetShaderiv(build->shaders[i], GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			char infoLog[512] = {};
+			glGetShaderInfoLog(build->shaders[i], 512, NULL, infoLog);
+
+			platform.debugOutput(build->shaderFiles[i]);
+			platform.debugOutput(" failed to compile:\n");
+			platform.debugOutput(infoLog);
+
+			compiled = false;
+		}
+	}
+
+	if (compiled)
+	{
+		s32 success;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			char infoLog[512] = {};
+			glGetProgramInfoLog(program, 512, NULL, infoLog);
+
+			platform.debugOutput("Shader program failed to link:\n");
+			platform.debugOutput(infoLog);
+
+			compiled = false;
+		}
+	}
 
 	// this works because a value of 0 for the shader defined as being silently ignored
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
-	glDeleteShader(tcs);
-	glDeleteShader(tes);
+	for (u32 i = 0; i < SHADER_STAGE_COUNT; ++i)
+		glDeleteShader(build->shaders[i]);
+
+	if (!compiled)
+	{
+		glDeleteProgram(program);
+		program = 0;
+	}
+	else if (build->cacheFile)
+	{
+		saveCachedProgram(platform, arena, build->cacheFile, build->cacheKey, program);
+	}
+
+	*build = {};
+
+	return program;
+}
+
+// returns the shader program made from the given shaders or 0 if it could not be built, any of the shader
+// files can be 0. If cacheFile isn't 0 the linked program binary is kept there to skip compiling next time, and
+// the arena is only used to stage it while it's written
+static u32 initShaders(Platform platform, MemoryArena* arena, char* vertexFile, char* fragmentFile, char* tcsFile,
+					   char* tesFile, char* cacheFile)
+{
+	char* shaderFiles[SHADER_STAGE_COUNT] = {vertexFile, fragmentFile, tcsFile, tesFile};
+	MappedFile shaderSources[SHADER_STAGE_COUNT];
+
+	u32 shaderProgram = 0;
+
+	if (readShaderSources(platform, shaderFiles, shaderSources))
+	{
+		if (!programBinariesSupported())
+			cacheFile = 0;
+
+		u64 cacheKey = 0;
+		if (cacheFile)
+		{
+			cacheKey = getProgramCacheKey(getDriverHash(), shaderSources);
+			shaderProgram = loadCachedProgram(platform, cacheFile, cacheKey);
+		}
+
+		if (!shaderProgram)
+		{
+			ProgramBuild build;
+			startProgramBuild(&build, shaderFiles, shaderSources, cacheFile, cacheKey);
+			shaderProgram = finishProgramBuild(platform, arena, &build);
+		}
+	}
+
+	freeShaderSources(platform, shaderSources);
+
+	if (shaderProgram)
+		glUseProgram(shaderProgram);
 	
 	return shaderProgram;
 }
@@ -2,6 +2,7 @@
 #define DENIS_STRINGS_H_
 
 #include "denis_types.h"
+#include "denis_memory.h"
 
 #define IS_LOWER_CASE(c) ((c) >= 'a' && (c) <= 'z')
 #define IS_UPPER_CASE(c) ((c) >= 'A' && (c) <= 'Z')
@@ -154,14 +155,16 @@ static inline int getStringSize(char* string)
 	return result;
 }
 
-//NOTE(denis): string returned from this function must be freed by the user
-static inline char* createStringFromArray(char* array, int size)
+//NOTE(denis): the returned string lives in the arena
+static inline char* createStringFromArray(MemoryArena* arena, char* array, int size)
 {
 	char* result = NULL;
  
 	if (array)
 	{
-		result = (char*)HEAP_ALLOC(size+1);
+		result = PUSH_ARRAY(arena, size+1, char);
+		if (!result)
+			return 0;
 	
 		int i;
 		for (i = 0; i < size; ++i)
@@ -173,7 +176,7 @@ static inline char* createStringFromArray(char* array, int size)
 	return result;
 }
 
-static inline char* duplicateString(char *string)
+static inline char* duplicateString(MemoryArena* arena, char *string)
 {
 	char *result = 0;
 	
@@ -181,21 +184,26 @@ static inline char* duplicateString(char *string)
 	{
 		u32 numChars = getStringSize(string);
 
-		result = (char*)HEAP_ALLOC(numChars+1);
+		result = PUSH_ARRAY(arena, numChars+1, char);
+		if (!result)
+			return 0;
 
 		for (u32 i = 0; i < numChars; ++i)
 		{
 			result[i] = string[i];
 		}
+		result[numChars] = 0;
 	}
 
 	return result;
 }
 
-//NOTE(denis): user must free result of this function
-static char** tokenizeStringInPlace(char* string, int maxTokens, char separator)
+//NOTE(denis): the token array lives in the arena, the tokens themselves point into string
+static char** tokenizeStringInPlace(MemoryArena* arena, char* string, int maxTokens, char separator)
 {
-	char** tokenArray = (char**)HEAP_ALLOC(maxTokens*sizeof(char*));
+	char** tokenArray = PUSH_ARRAY(arena, maxTokens, char*);
+	if (!tokenArray)
+		return 0;
 	
 	int i;
 	for (i = 0; i < maxTokens; ++i)
@@ -256,8 +264,8 @@ static inline void copyIntoString(char *destination, char *source,
 	}
 }
  
-//NOTE(denis): returns a new string which is a+b
-static char* concatStrings(char *a, char *b)
+//NOTE(denis): returns a new string which is a+b, allocated from the arena
+static char* concatStrings(MemoryArena* arena, char *a, char *b)
 {
 	u32 sizeOfA = 0;
 	u32 sizeOfB = 0;
@@ -275,10 +283,13 @@ static char* concatStrings(char *a, char *b)
 			++sizeOfB;
 		}
  
-		result = (char*)HEAP_ALLOC(sizeOfA+sizeOfB+1);
+		result = PUSH_ARRAY(arena, sizeOfA+sizeOfB+1, char);
+		if (!result)
+			return 0;
  
 		copyIntoString(result, a);
 		copyIntoString(result+sizeOfA, b);
+		result[sizeOfA+sizeOfB] = 0;
 	}
 	 
 	return result;
@@ -310,7 +321,7 @@ static bool toString(s32 num, char* buffer, u32 maxLength)
 	return success;
 }
 
-static char* toString(s32 num)
+static char* toString(MemoryArena* arena, s32 num)
 {
 	char* result = 0;
 	u32 length = 0;
@@ -325,10 +336,15 @@ static char* toString(s32 num)
 
 	if (length > 0)
 	{
-		result = (char*)HEAP_ALLOC(length+1);
-		if (!toString(num, result, length))
+		u64 usedBefore = arena->used;
+		result = PUSH_ARRAY(arena, length+1, char);
+		if (result && toString(num, result, length))
+		{
+			result[length] = 0;
+		}
+		else
 		{
-			HEAP_FREE(result);
+			arena->used = usedBefore;
 			result = 0;
 		}
 	}
@@ -0,0 +1,97 @@
+#if !defined(FRAME_EXPORT_H_)
+#define FRAME_EXPORT_H_
+
+// the export mode renders a camera sequence offscreen and writes every frame of it out as an image. The sequence
+// is either an input recording or a turntable, which orbits the camera once around the field with the wind on.
+// Frames are read back into a ring of pixel pack buffers so glReadPixels never waits on the GPU, and each buffer
+// is only mapped a few frames later, once its fence has passed. Encoding and writing the file happens on worker
+// threads straight out of the mapped buffer
+
+#define EXPORT_DEFAULT_FRAMES 360
+#define EXPORT_WIDTH 1280
+#define EXPORT_HEIGHT 720
+#define EXPORT_RANDOM_SEED 1234
+
+// every frame claims exactly this much time passed, so the simulation runs one step per frame
+#define EXPORT_TIMESTEP (1.0f/60.0f)
+
+// a frame is mapped EXPORT_READBACK_LATENCY frames after it was read, which leaves its worker
+// EXPORT_READBACK_BUFFERS - EXPORT_READBACK_LATENCY frames to finish before the buffer is needed again
+#define EXPORT_READBACK_BUFFERS 6
+#define EXPORT_READBACK_LATENCY 2
+#define EXPORT_WORKER_THREADS 4
+
+enum ExportFormat
+{
+	EXPORT_FORMAT_PNG,
+	EXPORT_FORMAT_TGA,
+	// the pixels exactly as they were read back: RGBA8, bottom row first, no header
+	EXPORT_FORMAT_RAW,
+
+	EXPORT_FORMAT_COUNT
+};
+
+static char* _exportFormatNames[EXPORT_FORMAT_COUNT] = {"png", "tga", "raw"};
+
+// returns EXPORT_FORMAT_COUNT if the name isn't a format we can write
+static ExportFormat getExportFormat(char* name)
+{
+	u32 result = 0;
+	while (result < EXPORT_FORMAT_COUNT && !stringsEqualIgnoreCase(name, _exportFormatNames[result]))
+		++result;
+
+	return (ExportFormat)result;
+}
+
+// 0 if the frame is too big for the format
+static u64 getExportFileSize(ExportFormat format, s32 width, s32 height)
+{
+	u64 result = 0;
+
+	switch (format)
+	{
+		case EXPORT_FORMAT_PNG:
+		{
+			result = getPNGFileSize(width, height);
+		} break;
+
+		case EXPORT_FORMAT_TGA:
+		{
+			if (width <= 0xFFFF && height <= 0xFFFF)
+				result = getTGAFileSize(width, height);
+		} break;
+
+		default:
+		{
+			result = (u64)width*height*4;
+		} break;
+	}
+
+	if (result > 0xFFFFFFFF)
+		result = 0;
+
+	return result;
+}
+
+// fills in the input the app receives on the given frame of a turntable. Every frame after the first turns the
+// camera by exactly 1/frameCount of an orbit, and it ends one frame short of the full orbit, so the frames loop
+// without the first one being repeated
+static void getTurntableInput(u32 frame, u32 frameCount, Input* input)
+{
+	*input = {};
+	input->mouse.leftClickStartPos = V2(-1, -1);
+	input->mouse.rightClickStartPos = V2(-1, -1);
+
+	if (frame == 0)
+	{
+		// wind is toggled when the action key is released
+		input->controller.actionPressed = true;
+	}
+	else
+	{
+		//NOTE(denis): turned directly rather than by dragging the mouse, whole pixels can't split an orbit evenly
+		input->cameraTurn = 2.0f*(f32)M_PI/(f32)frameCount;
+	}
+}
+
+#endif
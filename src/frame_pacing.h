@@ -0,0 +1,140 @@
+#if !defined(FRAME_PACING_H_)
+#define FRAME_PACING_H_
+
+#include <stdio.h>
+
+// how the platform hands finished frames to the display. The waiting itself is up to each platform layer, this is
+// the bookkeeping they all share: which mode we're in, what a frame's deadline is and how often it was missed
+
+enum PresentMode
+{
+	// the driver waits for the display's vertical blank, so the frame rate is the refresh rate
+	PRESENT_VSYNC,
+	// every frame is presented as soon as it's done, for benchmarking. There is no deadline to miss
+	PRESENT_UNCAPPED,
+	// no vsync, the platform sleeps (then spins for the last bit) until the next frame is due at a target rate
+	PRESENT_TARGET_RATE,
+
+	PRESENT_MODE_COUNT
+};
+
+static char* _presentModeNames[PRESENT_MODE_COUNT] = {"vsync", "uncapped", "target rate"};
+
+#define DEFAULT_TARGET_FRAME_RATE 60
+// used when the platform can't tell us the display's refresh rate
+#define DEFAULT_REFRESH_RATE 60
+
+// sleeps are only as precise as the OS scheduler (about 1ms once it's been asked for its finest period), so the
+// platform sleeps until this long before the deadline and spins for the rest
+#define PACING_SPIN_MS 2.0
+// a frame has missed its deadline when it took this fraction of a frame period longer than it should have. With
+// vsync a missed deadline means a whole refresh was skipped, so it shows up far above this
+#define PACING_MISS_TOLERANCE 0.25
+// how often the statistics are reported and reset, in milliseconds
+#define PACING_REPORT_INTERVAL_MS 5000.0
+
+// everything is summed since the last report
+struct PacingStats
+{
+	u32 frames;
+	u32 missedDeadlines;
+
+	// a frame's time is split into making it (appUpdate), presenting it (which is where the driver blocks for
+	// vsync) and the platform's own waiting for the target rate
+	f64 workMs;
+	f64 presentMs;
+	f64 waitMs;
+
+	f64 totalMs;
+	f64 worstFrameMs;
+};
+
+struct FramePacing
+{
+	PresentMode mode;
+	// 0 when frames have no deadline
+	f64 framePeriodMs;
+
+	PacingStats stats;
+};
+
+// takes "vsync", "uncapped" or a frame rate to target, returns false if the string is none of those
+static bool parsePresentMode(char* string, PresentMode* mode, u32* targetFrameRate)
+{
+	bool result = true;
+
+	if (stringsEqualIgnoreCase(string, "vsync"))
+	{
+		*mode = PRESENT_VSYNC;
+	}
+	else if (stringsEqualIgnoreCase(string, "uncapped"))
+	{
+		*mode = PRESENT_UNCAPPED;
+	}
+	else
+	{
+		u32 frameRate = parseU32String(string);
+		if (frameRate > 0)
+		{
+			*mode = PRESENT_TARGET_RATE;
+			*targetFrameRate = frameRate;
+		}
+		else
+		{
+			result = false;
+		}
+	}
+
+	return result;
+}
+
+// the frame rate is the display's refresh rate for vsync and the target for a target rate, and doesn't matter when
+// uncapped
+static FramePacing createFramePacing(PresentMode mode, u32 frameRate)
+{
+	FramePacing result = {};
+	result.mode = mode;
+
+	if (mode != PRESENT_UNCAPPED && frameRate > 0)
+		result.framePeriodMs = 1000.0/(f64)frameRate;
+
+	return result;
+}
+
+// frameMs is the whole frame, from the start of this frame to the start of the next
+static void recordPacedFrame(FramePacing* pacing, f64 workMs, f64 presentMs, f64 waitMs, f64 frameMs)
+{
+	PacingStats* stats = &pacing->stats;
+
+	++stats->frames;
+	stats->workMs += workMs;
+	stats->presentMs += presentMs;
+	stats->waitMs += waitMs;
+	stats->totalMs += frameMs;
+	stats->worstFrameMs = MAX(stats->worstFrameMs, frameMs);
+
+	if (pacing->framePeriodMs > 0.0 && frameMs > pacing->framePeriodMs*(1.0 + PACING_MISS_TOLERANCE))
+		++stats->missedDeadlines;
+}
+
+// writes a one line summary of the stats since the last report into buffer and starts collecting them again.
+// Returns false (and writes nothing) until PACING_REPORT_INTERVAL_MS has passed
+static bool reportFramePacing(FramePacing* pacing, char* buffer, u32 bufferSize)
+{
+	PacingStats* stats = &pacing->stats;
+	if (stats->totalMs < PACING_REPORT_INTERVAL_MS || stats->frames == 0)
+		return false;
+
+	f64 frames = (f64)stats->frames;
+	snprintf(buffer, bufferSize,
+			 "%s: %.1f fps, %u of %u frames missed their deadline (worst %.2fms), "
+			 "average work %.2fms, present %.2fms, wait %.2fms\n",
+			 _presentModeNames[pacing->mode], frames*1000.0/stats->totalMs, stats->missedDeadlines, stats->frames,
+			 stats->worstFrameMs, stats->workMs/frames, stats->presentMs/frames, stats->waitMs/frames);
+
+	*stats = {};
+
+	return true;
+}
+
+#endif
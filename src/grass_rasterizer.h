@@ -0,0 +1,638 @@
+#if !defined(GRASS_RASTERIZER_H_)
+#define GRASS_RASTERIZER_H_
+
+// A tile based software rasterizer for the triangles grass_reference.h makes, shaded the same way as
+// grass_fragment.glsl. Triangles are set up and binned into screen tiles in parallel, then every tile is
+// rasterized by one job, 4 pixels at a time with SSE edge functions, so no two threads ever touch the same pixel.
+// Within a tile the triangles are drawn in the order they were given, so the output doesn't depend on timing.
+//
+//NOTE(denis): where this differs from the GPU:
+// - the blade mask and diffuse texture are sampled from their first level, there are no derivatives to pick a mip
+// - the mask is a hard cut out, the same as drawing without MSAA
+// - triangles that cross the near plane are clipped against it like the GPU does, but the pieces are drawn after
+//   every other triangle in their tiles, so they only come out differently where two depths are exactly equal
+
+// has to be a multiple of 4 so the 4 pixel groups never straddle two tiles
+#define RASTER_TILE_SIZE 64
+
+// setup is split into jobs of at least this many triangles, and never more jobs than this. Tiles are dealt out to
+// the same number of jobs, and every stage's jobs are spread over the threads with a parallelFor
+#define RASTER_MIN_TRIANGLES_PER_JOB 2048
+#define RASTER_MAX_JOBS 64
+
+struct SoftwareTarget
+{
+	s32 width;
+	s32 height;
+
+	// RGBA8 and a [0, 1] depth for every pixel, bottom row first like GL
+	u8* colour;
+	f32* depth;
+};
+
+// the fragment shader's textures, the species say which layers a blade uses
+struct RasterTextures
+{
+	ReferenceImage alphaLayers[MAX_TEXTURE_LAYERS];
+	ReferenceImage diffuseLayers[MAX_TEXTURE_LAYERS];
+
+	// BLADE_SPECIES_COUNT of them
+	BladeSpecies* species;
+};
+
+struct RasterTriangle
+{
+	// edge function i is A*x + B*y + C in pixels, 0 along the edge opposite vertex i and positive inside
+	f32 edgeA[3];
+	f32 edgeB[3];
+	f32 edgeC[3];
+	// whether a pixel centre right on the edge is inside, so an edge shared by two triangles is only drawn once
+	bool edgeInclusive[3];
+	f32 invArea;
+
+	f32 depth[3];
+	f32 invW[3];
+	// indices into the batch's vertices, see getRasterVertex
+	u32 vertices[3];
+
+	// inclusive pixel bounds, minX is bigger than maxX when the triangle was dropped
+	s32 minX;
+	s32 minY;
+	s32 maxX;
+	s32 maxY;
+};
+
+struct RasterBatch
+{
+	SoftwareTarget* target;
+	RasterTextures* textures;
+	GrassReferenceVertex* vertices;
+
+	// the pieces of triangles that crossed the near plane, as a triangle list. They are numbered after the given
+	// vertices, so triangle i always starts at vertex i*3 of the two together
+	GrassReferenceVertex* clippedVertices;
+	u32 givenTriangleCount;
+
+	RasterTriangle* triangles;
+	u32 triangleCount;
+
+	s32 tilesX;
+	s32 tilesY;
+	u32 jobCount;
+
+	// jobCount rows of tilesX*tilesY. Setup counts how many triangles every job puts in every tile, and then they
+	// are turned into where each job writes its triangle indices in tileTriangles
+	u32* jobTileCounts;
+	// the triangles of tile i are tileTriangles[tileStarts[i]] up to tileTriangles[tileStarts[i + 1]]
+	u32* tileTriangles;
+	u32* tileStarts;
+};
+
+struct RasterSetupJob
+{
+	RasterBatch* batch;
+	u32 jobIndex;
+	u32 firstTriangle;
+	u32 triangleCount;
+};
+
+struct RasterTileJob
+{
+	RasterBatch* batch;
+	u32 firstTile;
+	u32 tileStep;
+};
+
+static void clearSoftwareTarget(SoftwareTarget* target, v4f colour)
+{
+	u8 clearColour[4];
+	for (u32 i = 0; i < 4; ++i)
+		clearColour[i] = (u8)(CLAMP_RANGE(colour.e[i], 0.0f, 1.0f)*255.0f + 0.5f);
+
+	u64 pixelCount = (u64)target->width*target->height;
+	for (u64 i = 0; i < pixelCount; ++i)
+	{
+		memcpy(target->colour + i*4, clearColour, 4);
+		target->depth[i] = 1.0f;
+	}
+}
+
+static inline GrassReferenceVertex* getRasterVertex(RasterBatch* batch, u32 index)
+{
+	u32 givenVertexCount = batch->givenTriangleCount*3;
+	if (index < givenVertexCount)
+		return &batch->vertices[index];
+
+	return &batch->clippedVertices[index - givenVertexCount];
+}
+
+// the attributes that vary across a blade are interpolated in clip space, which is what the GPU's clipper does too
+static GrassReferenceVertex lerpRasterVertex(GrassReferenceVertex* a, GrassReferenceVertex* b, f32 t)
+{
+	GrassReferenceVertex result = *a;
+	result.clipPos = a->clipPos + (b->clipPos - a->clipPos)*t;
+	result.normal = a->normal + (b->normal - a->normal)*t;
+	result.texturePos = a->texturePos + (b->texturePos - a->texturePos)*t;
+
+	return result;
+}
+
+static inline bool crossesNearPlane(GrassReferenceVertex* triangle)
+{
+	u32 behind = 0;
+	for (u32 i = 0; i < 3; ++i)
+	{
+		if (triangle[i].clipPos.z < -triangle[i].clipPos.w)
+			++behind;
+	}
+
+	return behind > 0 && behind < 3;
+}
+
+// clips the part of the triangle behind the near plane (z < -w) off, and writes what's left as up to two triangles
+// with the same winding. Returns how many it wrote
+static u32 clipToNearPlane(GrassReferenceVertex* triangle, GrassReferenceVertex* clipped)
+{
+	GrassReferenceVertex polygon[4];
+	u32 polygonCount = 0;
+
+	for (u32 i = 0; i < 3; ++i)
+	{
+		GrassReferenceVertex* a = &triangle[i];
+		GrassReferenceVertex* b = &triangle[(i + 1) % 3];
+		f32 distanceA = a->clipPos.z + a->clipPos.w;
+		f32 distanceB = b->clipPos.z + b->clipPos.w;
+
+		if (distanceA >= 0.0f)
+			polygon[polygonCount++] = *a;
+		if ((distanceA >= 0.0f) != (distanceB >= 0.0f))
+		{
+			// put exactly on the plane, rounding could leave it just behind and get the piece dropped
+			GrassReferenceVertex* vertex = &polygon[polygonCount++];
+			*vertex = lerpRasterVertex(a, b, distanceA/(distanceA - distanceB));
+			vertex->clipPos.z = -vertex->clipPos.w;
+		}
+	}
+
+	if (polygonCount < 3)
+		return 0;
+
+	clipped[0] = polygon[0];
+	clipped[1] = polygon[1];
+	clipped[2] = polygon[2];
+	if (polygonCount == 4)
+	{
+		clipped[3] = polygon[0];
+		clipped[4] = polygon[2];
+		clipped[5] = polygon[3];
+	}
+
+	return polygonCount - 2;
+}
+
+// a triangle that crosses the near plane is dropped here, its clipped pieces are set up on their own
+static void setupRasterTriangle(RasterBatch* batch, u32 triangleIndex, RasterTriangle* triangle)
+{
+	SoftwareTarget* target = batch->target;
+	triangle->minX = 1;
+	triangle->maxX = 0;
+
+	v3f screen[3];
+	f32 invW[3];
+	u32 indices[3] = {triangleIndex*3, triangleIndex*3 + 1, triangleIndex*3 + 2};
+	for (u32 i = 0; i < 3; ++i)
+	{
+		v4f clipPos = getRasterVertex(batch, indices[i])->clipPos;
+		if (clipPos.w <= 0.0f || clipPos.z < -clipPos.w)
+			return;
+
+		invW[i] = 1.0f/clipPos.w;
+		screen[i] = V3f((clipPos.x*invW[i]*0.5f + 0.5f)*target->width, (clipPos.y*invW[i]*0.5f + 0.5f)*target->height,
+						clipPos.z*invW[i]*0.5f + 0.5f);
+	}
+
+	f32 area = (screen[1].x - screen[0].x)*(screen[2].y - screen[0].y) -
+		(screen[2].x - screen[0].x)*(screen[1].y - screen[0].y);
+	if (!(area != 0.0f))
+		return;
+
+	// blades are seen from both sides, clockwise triangles are turned around so the edge functions are positive
+	if (area < 0.0f)
+	{
+		v3f tempScreen = screen[1];
+		screen[1] = screen[2];
+		screen[2] = tempScreen;
+
+		f32 tempInvW = invW[1];
+		invW[1] = invW[2];
+		invW[2] = tempInvW;
+
+		u32 tempIndex = indices[1];
+		indices[1] = indices[2];
+		indices[2] = tempIndex;
+
+		area = -area;
+	}
+
+	// pixel centres are at +0.5
+	f32 minX = MIN(screen[0].x, MIN(screen[1].x, screen[2].x));
+	f32 maxX = MAX(screen[0].x, MAX(screen[1].x, screen[2].x));
+	f32 minY = MIN(screen[0].y, MIN(screen[1].y, screen[2].y));
+	f32 maxY = MAX(screen[0].y, MAX(screen[1].y, screen[2].y));
+	if (maxX < 0.0f || maxY < 0.0f || minX > (f32)target->width || minY > (f32)target->height)
+		return;
+
+	s32 pixelMinX = MAX((s32)ceilf(minX - 0.5f), 0);
+	s32 pixelMinY = MAX((s32)ceilf(minY - 0.5f), 0);
+	s32 pixelMaxX = MIN((s32)floorf(maxX - 0.5f), target->width - 1);
+	s32 pixelMaxY = MIN((s32)floorf(maxY - 0.5f), target->height - 1);
+	if (pixelMinX > pixelMaxX || pixelMinY > pixelMaxY)
+		return;
+
+	for (u32 i = 0; i < 3; ++i)
+	{
+		v3f a = screen[(i + 1) % 3];
+		v3f b = screen[(i + 2) % 3];
+
+		f32 edgeA = a.y - b.y;
+		f32 edgeB = b.x - a.x;
+		triangle->edgeA[i] = edgeA;
+		triangle->edgeB[i] = edgeB;
+		triangle->edgeC[i] = -(edgeA*a.x + edgeB*a.y);
+		// the neighbour sharing this edge has it flipped, so exactly one of the two includes the pixels on it
+		triangle->edgeInclusive[i] = edgeA > 0.0f || (edgeA == 0.0f && edgeB < 0.0f);
+
+		triangle->depth[i] = screen[i].z;
+		triangle->invW[i] = invW[i];
+		triangle->vertices[i] = indices[i];
+	}
+
+	triangle->invArea = 1.0f/area;
+	triangle->minX = pixelMinX;
+	triangle->minY = pixelMinY;
+	triangle->maxX = pixelMaxX;
+	triangle->maxY = pixelMaxY;
+}
+
+// grass_fragment.glsl for one pixel, l0, l1 and l2 are the screen space barycentric coordinates. Returns false
+// if the fragment is discarded
+static bool shadeGrassFragment(RasterTextures* textures, GrassReferenceVertex* vertices[3], f32 invW[3],
+							   f32 l0, f32 l1, f32 l2, u8* colour)
+{
+	// perspective correct weights for the attributes
+	f32 w0 = l0*invW[0];
+	f32 w1 = l1*invW[1];
+	f32 w2 = l2*invW[2];
+	f32 invWeightSum = 1.0f/(w0 + w1 + w2);
+	w0 *= invWeightSum;
+	w1 *= invWeightSum;
+	w2 *= invWeightSum;
+
+	v2f texturePos = vertices[0]->texturePos*w0 + vertices[1]->texturePos*w1 + vertices[2]->texturePos*w2;
+	// the shader doesn't normalize the interpolated normal either
+	v3f normal = vertices[0]->normal*w0 + vertices[1]->normal*w1 + vertices[2]->normal*w2;
+
+	// these are the same for every vertex of a blade
+	GrassReferenceVertex* blade = vertices[0];
+	BladeSpecies* species = &textures->species[blade->species];
+
+	f32 mask = sampleReferenceImage(&textures->alphaLayers[species->alphaLayer], texturePos).r;
+	// the shader's maskThreshold
+	if (mask < 0.5f)
+		return false;
+
+	v4f grassColour = sampleReferenceImage(&textures->diffuseLayers[species->diffuseLayer], texturePos);
+	v3f tint = species->rootColour + (species->tipColour - species->rootColour)*texturePos.x;
+	grassColour.xyz = hadamard(grassColour.xyz, tint);
+
+	grassColour.r += grassColour.r*(blade->random.x*0.5f - 0.25f);
+	grassColour.g += grassColour.g*(blade->random.y*0.5f - 0.25f);
+	grassColour.b += grassColour.b*(blade->random.z*0.5f - 0.25f);
+
+	v3f lightPos = V3f(0.0f, 0.0f, 5.0f);
+	v3f lightDir = normalize(blade->centrePos - lightPos);
+	f32 intensity = ABS_VALUE(dot(lightDir, normal));
+
+	f32 result[4];
+	for (u32 i = 0; i < 3; ++i)
+		result[i] = 0.5f*grassColour.e[i] + grassColour.e[i]*intensity*texturePos.x;
+	result[3] = 1.0f;
+
+	for (u32 i = 0; i < 4; ++i)
+		colour[i] = (u8)(CLAMP_RANGE(result[i], 0.0f, 1.0f)*255.0f + 0.5f);
+
+	return true;
+}
+
+static void rasterizeTriangle(RasterBatch* batch, RasterTriangle* triangle, s32 tileMinX, s32 tileMinY,
+							  s32 tileMaxX, s32 tileMaxY)
+{
+	SoftwareTarget* target = batch->target;
+
+	// the tile starts on a multiple of 4, so rounding down keeps the groups inside it
+	s32 minX = MAX(triangle->minX, tileMinX) & ~3;
+	s32 maxX = MIN(triangle->maxX, tileMaxX);
+	s32 minY = MAX(triangle->minY, tileMinY);
+	s32 maxY = MIN(triangle->maxY, tileMaxY);
+
+	GrassReferenceVertex* vertices[3];
+	for (u32 i = 0; i < 3; ++i)
+		vertices[i] = getRasterVertex(batch, triangle->vertices[i]);
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 pixelCentres = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	__m128 laneOffsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	__m128 lastX = _mm_set1_ps((f32)maxX);
+	__m128 invArea = _mm_set1_ps(triangle->invArea);
+	__m128 depth0 = _mm_set1_ps(triangle->depth[0]);
+	__m128 depthStep1 = _mm_set1_ps(triangle->depth[1] - triangle->depth[0]);
+	__m128 depthStep2 = _mm_set1_ps(triangle->depth[2] - triangle->depth[0]);
+
+	__m128 edgeA[3];
+	__m128 edgeB[3];
+	__m128 edgeC[3];
+	for (u32 i = 0; i < 3; ++i)
+	{
+		edgeA[i] = _mm_set1_ps(triangle->edgeA[i]);
+		edgeB[i] = _mm_set1_ps(triangle->edgeB[i]);
+		edgeC[i] = _mm_set1_ps(triangle->edgeC[i]);
+	}
+
+	for (s32 y = minY; y <= maxY; ++y)
+	{
+		__m128 pixelY = _mm_set1_ps((f32)y + 0.5f);
+		__m128 rowEdges[3];
+		for (u32 i = 0; i < 3; ++i)
+			rowEdges[i] = _mm_add_ps(_mm_mul_ps(edgeB[i], pixelY), edgeC[i]);
+
+		f32* depthRow = target->depth + (s64)y*target->width;
+		u8* colourRow = target->colour + (s64)y*target->width*4;
+
+		for (s32 x = minX; x <= maxX; x += 4)
+		{
+			__m128 groupX = _mm_set1_ps((f32)x);
+			__m128 pixelX = _mm_add_ps(groupX, pixelCentres);
+
+			// lanes past the end of the triangle's span are in the next tile (or off the target)
+			__m128 inside = _mm_cmple_ps(_mm_add_ps(groupX, laneOffsets), lastX);
+
+			__m128 edges[3];
+			for (u32 i = 0; i < 3; ++i)
+			{
+				edges[i] = _mm_add_ps(_mm_mul_ps(edgeA[i], pixelX), rowEdges[i]);
+				__m128 edgeInside = triangle->edgeInclusive[i] ? _mm_cmpge_ps(edges[i], zero) :
+					_mm_cmpgt_ps(edges[i], zero);
+				inside = _mm_and_ps(inside, edgeInside);
+			}
+
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+
+			__m128 l1 = _mm_mul_ps(edges[1], invArea);
+			__m128 l2 = _mm_mul_ps(edges[2], invArea);
+			__m128 depth = _mm_add_ps(depth0, _mm_add_ps(_mm_mul_ps(l1, depthStep1), _mm_mul_ps(l2, depthStep2)));
+
+			f32 storedDepth[4] = {};
+			for (s32 lane = 0; lane < 4 && x + lane <= maxX; ++lane)
+				storedDepth[lane] = depthRow[x + lane];
+			inside = _mm_and_ps(inside, _mm_cmplt_ps(depth, _mm_loadu_ps(storedDepth)));
+
+			s32 laneMask = _mm_movemask_ps(inside);
+			if (laneMask == 0)
+				continue;
+
+			f32 depths[4];
+			f32 lanesL0[4];
+			f32 lanesL1[4];
+			f32 lanesL2[4];
+			_mm_storeu_ps(depths, depth);
+			_mm_storeu_ps(lanesL0, _mm_mul_ps(edges[0], invArea));
+			_mm_storeu_ps(lanesL1, l1);
+			_mm_storeu_ps(lanesL2, l2);
+
+			for (s32 lane = 0; lane < 4; ++lane)
+			{
+				if (!(laneMask & (1 << lane)))
+					continue;
+
+				u8 colour[4];
+				if (shadeGrassFragment(batch->textures, vertices, triangle->invW, lanesL0[lane], lanesL1[lane],
+									   lanesL2[lane], colour))
+				{
+					depthRow[x + lane] = depths[lane];
+					memcpy(colourRow + (x + lane)*4, colour, 4);
+				}
+			}
+		}
+	}
+}
+
+static inline void getTriangleTiles(RasterTriangle* triangle, s32* minTileX, s32* minTileY, s32* maxTileX,
+									s32* maxTileY)
+{
+	*minTileX = triangle->minX / RASTER_TILE_SIZE;
+	*minTileY = triangle->minY / RASTER_TILE_SIZE;
+	*maxTileX = triangle->maxX / RASTER_TILE_SIZE;
+	*maxTileY = triangle->maxY / RASTER_TILE_SIZE;
+}
+
+static void rasterSetupJob(RasterSetupJob* job)
+{
+	RasterBatch* batch = job->batch;
+	u32* tileCounts = batch->jobTileCounts + job->jobIndex*batch->tilesX*batch->tilesY;
+
+	for (u32 i = job->firstTriangle; i < job->firstTriangle + job->triangleCount; ++i)
+	{
+		RasterTriangle* triangle = &batch->triangles[i];
+		setupRasterTriangle(batch, i, triangle);
+		if (triangle->minX > triangle->maxX)
+			continue;
+
+		s32 minTileX, minTileY, maxTileX, maxTileY;
+		getTriangleTiles(triangle, &minTileX, &minTileY, &maxTileX, &maxTileY);
+		for (s32 tileY = minTileY; tileY <= maxTileY; ++tileY)
+		{
+			for (s32 tileX = minTileX; tileX <= maxTileX; ++tileX)
+				++tileCounts[tileY*batch->tilesX + tileX];
+		}
+	}
+}
+
+static void rasterBinJob(RasterSetupJob* job)
+{
+	RasterBatch* batch = job->batch;
+	u32* tileOffsets = batch->jobTileCounts + job->jobIndex*batch->tilesX*batch->tilesY;
+
+	for (u32 i = job->firstTriangle; i < job->firstTriangle + job->triangleCount; ++i)
+	{
+		RasterTriangle* triangle = &batch->triangles[i];
+		if (triangle->minX > triangle->maxX)
+			continue;
+
+		s32 minTileX, minTileY, maxTileX, maxTileY;
+		getTriangleTiles(triangle, &minTileX, &minTileY, &maxTileX, &maxTileY);
+		for (s32 tileY = minTileY; tileY <= maxTileY; ++tileY)
+		{
+			for (s32 tileX = minTileX; tileX <= maxTileX; ++tileX)
+				batch->tileTriangles[tileOffsets[tileY*batch->tilesX + tileX]++] = i;
+		}
+	}
+}
+
+static void rasterTileJob(RasterTileJob* job)
+{
+	RasterBatch* batch = job->batch;
+	u32 tileCount = batch->tilesX*batch->tilesY;
+
+	for (u32 tile = job->firstTile; tile < tileCount; tile += job->tileStep)
+	{
+		s32 tileMinX = (tile % batch->tilesX)*RASTER_TILE_SIZE;
+		s32 tileMinY = (tile / batch->tilesX)*RASTER_TILE_SIZE;
+		s32 tileMaxX = MIN(tileMinX + RASTER_TILE_SIZE, batch->target->width) - 1;
+		s32 tileMaxY = MIN(tileMinY + RASTER_TILE_SIZE, batch->target->height) - 1;
+
+		for (u32 i = batch->tileStarts[tile]; i < batch->tileStarts[tile + 1]; ++i)
+		{
+			RasterTriangle* triangle = &batch->triangles[batch->tileTriangles[i]];
+			rasterizeTriangle(batch, triangle, tileMinX, tileMinY, tileMaxX, tileMaxY);
+		}
+	}
+}
+
+// the range callbacks for the stages' parallelFors, data is the stage's array of jobs
+static WORK_RANGE_CALLBACK(rasterSetupJobs)
+{
+	for (u32 i = first; i < onePastLast; ++i)
+		rasterSetupJob((RasterSetupJob*)data + i);
+}
+
+static WORK_RANGE_CALLBACK(rasterBinJobs)
+{
+	for (u32 i = first; i < onePastLast; ++i)
+		rasterBinJob((RasterSetupJob*)data + i);
+}
+
+static WORK_RANGE_CALLBACK(rasterTileJobs)
+{
+	for (u32 i = first; i < onePastLast; ++i)
+		rasterTileJob((RasterTileJob*)data + i);
+}
+
+// draws a triangle list from runGrassReference into the target on every core, depth tested against what is
+// already there. Everything it needs is pushed onto the arena and given back before it returns
+static bool rasterizeGrass(Platform platform, MemoryArena* arena, SoftwareTarget* target, RasterTextures* textures,
+						   GrassReferenceVertex* vertices, u32 vertexCount)
+{
+	u32 givenTriangleCount = vertexCount/3;
+	if (givenTriangleCount == 0)
+		return true;
+
+	TemporaryMemory rasterMemory = beginTemporaryMemory(arena);
+
+	RasterBatch batch = {};
+	batch.target = target;
+	batch.textures = textures;
+	batch.vertices = vertices;
+	batch.givenTriangleCount = givenTriangleCount;
+	batch.tilesX = (target->width + RASTER_TILE_SIZE - 1)/RASTER_TILE_SIZE;
+	batch.tilesY = (target->height + RASTER_TILE_SIZE - 1)/RASTER_TILE_SIZE;
+	u32 tileCount = batch.tilesX*batch.tilesY;
+
+	//NOTE(denis): only the blades right in front of the camera cross the near plane, so this is a quick pass on
+	// one thread. Each of them turns into at most two triangles
+	u32 crossingCount = 0;
+	for (u32 i = 0; i < givenTriangleCount; ++i)
+	{
+		if (crossesNearPlane(vertices + i*3))
+			++crossingCount;
+	}
+
+	u32 clippedTriangleCount = 0;
+	if (crossingCount > 0)
+	{
+		batch.clippedVertices = TRY_PUSH_ARRAY(arena, (u64)crossingCount*6, GrassReferenceVertex);
+		if (!batch.clippedVertices)
+		{
+			endTemporaryMemory(rasterMemory);
+			return false;
+		}
+
+		for (u32 i = 0; i < givenTriangleCount; ++i)
+		{
+			if (crossesNearPlane(vertices + i*3))
+			{
+				clippedTriangleCount += clipToNearPlane(vertices + i*3,
+														batch.clippedVertices + clippedTriangleCount*3);
+			}
+		}
+	}
+
+	u32 triangleCount = givenTriangleCount + clippedTriangleCount;
+	batch.triangleCount = triangleCount;
+
+	u32 trianglesPerJob = MAX(RASTER_MIN_TRIANGLES_PER_JOB, (triangleCount + RASTER_MAX_JOBS - 1)/RASTER_MAX_JOBS);
+	batch.jobCount = (triangleCount + trianglesPerJob - 1)/trianglesPerJob;
+
+	batch.triangles = TRY_PUSH_ARRAY(arena, triangleCount, RasterTriangle);
+	batch.jobTileCounts = TRY_PUSH_ARRAY(arena, batch.jobCount*tileCount, u32);
+	batch.tileStarts = TRY_PUSH_ARRAY(arena, tileCount + 1, u32);
+	RasterSetupJob* setupJobs = TRY_PUSH_ARRAY(arena, batch.jobCount, RasterSetupJob);
+	RasterTileJob* tileJobs = TRY_PUSH_ARRAY(arena, RASTER_MAX_JOBS, RasterTileJob);
+	if (!batch.triangles || !batch.jobTileCounts || !batch.tileStarts || !setupJobs || !tileJobs)
+	{
+		endTemporaryMemory(rasterMemory);
+		return false;
+	}
+	memset(batch.jobTileCounts, 0, batch.jobCount*tileCount*sizeof(u32));
+
+	for (u32 i = 0; i < batch.jobCount; ++i)
+	{
+		RasterSetupJob* job = &setupJobs[i];
+		job->batch = &batch;
+		job->jobIndex = i;
+		job->firstTriangle = i*trianglesPerJob;
+		job->triangleCount = MIN(trianglesPerJob, triangleCount - job->firstTriangle);
+	}
+	platform.parallelFor(platform.workQueue, batch.jobCount, 1, rasterSetupJobs, setupJobs);
+
+	// each job's triangles go after the earlier jobs' in every tile, which keeps them in submission order
+	u32 binnedCount = 0;
+	for (u32 tile = 0; tile < tileCount; ++tile)
+	{
+		batch.tileStarts[tile] = binnedCount;
+		for (u32 job = 0; job < batch.jobCount; ++job)
+		{
+			u32* count = &batch.jobTileCounts[job*tileCount + tile];
+			u32 jobTriangles = *count;
+			*count = binnedCount;
+			binnedCount += jobTriangles;
+		}
+	}
+	batch.tileStarts[tileCount] = binnedCount;
+
+	batch.tileTriangles = TRY_PUSH_ARRAY(arena, binnedCount, u32);
+	if (!batch.tileTriangles)
+	{
+		endTemporaryMemory(rasterMemory);
+		return false;
+	}
+
+	platform.parallelFor(platform.workQueue, batch.jobCount, 1, rasterBinJobs, setupJobs);
+
+	// tiles are dealt out round robin, the busy part of the screen is usually a band across it
+	u32 tileJobCount = MIN(tileCount, (u32)RASTER_MAX_JOBS);
+	for (u32 i = 0; i < tileJobCount; ++i)
+	{
+		RasterTileJob* job = &tileJobs[i];
+		job->batch = &batch;
+		job->firstTile = i;
+		job->tileStep = tileJobCount;
+	}
+	platform.parallelFor(platform.workQueue, tileJobCount, 1, rasterTileJobs, tileJobs);
+
+	endTemporaryMemory(rasterMemory);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,590 @@
+#if !defined(GRASS_REFERENCE_H_)
+#define GRASS_REFERENCE_H_
+
+#include <float.h>
+#include <xmmintrin.h>
+
+// A CPU port of the grass program's geometry stages: grass_vertex.glsl, grass_tess_control.glsl and
+// grass_tess_eval.glsl. It takes the same GrassBlade data and uniforms and writes out the triangles the GPU would
+// rasterize, with everything the fragment shader gets for each vertex. It is for golden output comparisons and
+// for anything on the CPU (bounds, culling, physics) that has to agree with what is drawn.
+//
+//NOTE(denis): any change to those shaders has to be made here as well. The shaders' quirks are kept on purpose,
+// the point is to get the same answer as the GPU, not a better one.
+//
+// How the quad domain is split into triangles is up to the driver, so only the positions are comparable, not the
+// triangle order. Blades are linear across their width (u), so the GPU's vertices in the middle of a row land on
+// the line between the row's edge vertices. The reference only evaluates the left and right edges of every row
+// and gives the same surface, with normals in between the edges interpolated instead of evaluated.
+
+// these match maxTessellation and maxDistance in grass_tess_control.glsl
+#define REFERENCE_MAX_TESS_LEVEL 8
+#define REFERENCE_MAX_TESS_DISTANCE 15.0f
+
+// every row of a tessellated blade is two triangles
+#define REFERENCE_MAX_VERTICES_PER_BLADE (REFERENCE_MAX_TESS_LEVEL*6)
+
+// blades are split into jobs of at least this many, and never more jobs than this. The jobs are spread over the
+// threads with a parallelFor
+#define REFERENCE_MIN_BLADES_PER_JOB 256
+#define REFERENCE_MAX_JOBS 64
+
+// the grass program's uniforms for drawing one patch
+struct GrassReferenceInput
+{
+	Matrix4f objectTransform;
+	Matrix4f viewTransform;
+	Matrix4f projectionTransform;
+
+	v2f patchPos;
+	v3f fieldRect[2];
+	v3f cameraPos;
+	f32 time;
+	bool windActive;
+
+	// for picking tessellation levels, the same as the shader's uniforms
+	f32 viewportHeight;
+	f32 projectionScale;
+	f32 pixelsPerSegment;
+	f32 minFacingPixels;
+
+	ReferenceImage forceMap;
+	ReferenceImage heightMap;
+	ReferenceImage vegetationMap;
+	f32 heightScale;
+
+	// BLADE_SPECIES_COUNT of them
+	BladeSpecies* species;
+};
+
+// what grass_tess_eval.glsl hands on to the fragment shader for one vertex
+struct GrassReferenceVertex
+{
+	// gl_Position
+	v4f clipPos;
+
+	v3f centrePos;
+	v3f normal;
+	v2f texturePos;
+	v3f random;
+	s32 species;
+};
+
+struct GrassReferenceOutput
+{
+	// a triangle list, blades are in the order they were given
+	GrassReferenceVertex* vertices;
+	u32 vertexCount;
+
+	// world space bounds of every vertex, min is bigger than max when nothing was output
+	v3f boundsMin;
+	v3f boundsMax;
+};
+
+// makes a reference image out of the first level of an uncompressed texture, 0 pixels for any other format
+static ReferenceImage copyReferenceImage(MemoryArena* arena, TextureData* texture)
+{
+	ReferenceImage result = {};
+
+	s32 componentCount = 0;
+	if (texture->format == TEXTURE_FORMAT_RGBA8)
+		componentCount = 4;
+	else if (texture->format == TEXTURE_FORMAT_R8)
+		componentCount = 1;
+
+	if (componentCount == 0 || texture->levelCount == 0)
+		return result;
+
+	TextureLevel* level = &texture->levels[0];
+	u8* pixels = TRY_PUSH_ARRAY(arena, level->size, u8);
+	if (!pixels)
+		return result;
+
+	memcpy(pixels, texture->levelData[0], level->size);
+	result.pixels = pixels;
+	result.width = (s32)level->width;
+	result.height = (s32)level->height;
+	result.componentCount = componentCount;
+
+	return result;
+}
+
+// the missing components of a one channel texture come back as 0, 0, 1 the way GL_RED textures do
+static inline v4f fetchReferenceTexel(ReferenceImage* image, s32 x, s32 y)
+{
+	v4f result = V4f(0.0f, 0.0f, 0.0f, 1.0f);
+	if (!image->pixels)
+		return result;
+
+	x = CLAMP_RANGE(x, 0, image->width - 1);
+	y = CLAMP_RANGE(y, 0, image->height - 1);
+
+	u8* texel = image->pixels + (y*image->width + x)*image->componentCount;
+	for (s32 i = 0; i < image->componentCount; ++i)
+		result.e[i] = texel[i]/255.0f;
+
+	return result;
+}
+
+static v4f sampleReferenceImage(ReferenceImage* image, v2f pos)
+{
+	f32 x = pos.x*image->width - 0.5f;
+	f32 y = pos.y*image->height - 0.5f;
+	f32 floorX = floorf(x);
+	f32 floorY = floorf(y);
+	f32 fractionX = x - floorX;
+	f32 fractionY = y - floorY;
+	s32 x0 = (s32)floorX;
+	s32 y0 = (s32)floorY;
+
+	v4f t00 = fetchReferenceTexel(image, x0, y0);
+	v4f t10 = fetchReferenceTexel(image, x0 + 1, y0);
+	v4f t01 = fetchReferenceTexel(image, x0, y0 + 1);
+	v4f t11 = fetchReferenceTexel(image, x0 + 1, y0 + 1);
+
+	v4f result;
+	for (u32 i = 0; i < 4; ++i)
+	{
+		f32 bottom = t00.e[i] + (t10.e[i] - t00.e[i])*fractionX;
+		f32 top = t01.e[i] + (t11.e[i] - t01.e[i])*fractionX;
+		result.e[i] = bottom + (top - bottom)*fractionY;
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------
+// grass_vertex.glsl
+
+struct ReferenceBladeVertex
+{
+	v3f pos;
+	v4f centrePos;
+	v2f texturePos;
+	v4f random;
+	s32 species;
+};
+
+static inline v2f referenceFieldMapPos(GrassReferenceInput* input, v3f patchRelativePos)
+{
+	v3f fieldWorldPos = V3f(input->patchPos.x, 0.0f, input->patchPos.y) +
+		(patchRelativePos + V3f(0.5f, 0.0f, 0.5f));
+	v3f fieldRelativePos = fieldWorldPos - input->fieldRect[0];
+	v3f fieldDimensions = input->fieldRect[1] - input->fieldRect[0];
+
+	return V2f(fieldRelativePos.x / fieldDimensions.x, fieldRelativePos.z / fieldDimensions.z);
+}
+
+static inline s32 referenceBladeSpecies(GrassReferenceInput* input, v3f patchRelativePos)
+{
+	ReferenceImage* map = &input->vegetationMap;
+	v2f mapPos = referenceFieldMapPos(input, patchRelativePos);
+	s32 x = CLAMP_RANGE((s32)(mapPos.x*map->width), 0, map->width - 1);
+	s32 y = CLAMP_RANGE((s32)(mapPos.y*map->height), 0, map->height - 1);
+
+	s32 species = (s32)(fetchReferenceTexel(map, x, y).r*BLADE_SPECIES_COUNT);
+	return MIN(species, BLADE_SPECIES_COUNT - 1);
+}
+
+static ReferenceBladeVertex runReferenceVertexShader(GrassReferenceInput* input, v4f pos, v4f centrePos,
+													 v4f texturePos, v4f random)
+{
+	ReferenceBladeVertex result;
+
+	s32 species = referenceBladeSpecies(input, V3f(centrePos.x, 0.0f, centrePos.z));
+	BladeSpecies* bladeSpecies = &input->species[species];
+
+	f32 angle = 2.0f*(f32)M_PI*pos.w;
+	f32 dx = bladeSpecies->widthScale*(pos.x - centrePos.x);
+	f32 dz = bladeSpecies->widthScale*(pos.z - centrePos.z);
+	f32 newX = centrePos.x + cosf(angle)*dx - sinf(angle)*dz;
+	f32 newZ = centrePos.z + sinf(angle)*dx + cosf(angle)*dz;
+
+	v2f rootMapPos = referenceFieldMapPos(input, V3f(centrePos.x, 0.0f, centrePos.z));
+	f32 rootHeight = sampleReferenceImage(&input->heightMap, rootMapPos).r*input->heightScale;
+	v3f newPos = V3f(newX, pos.y*bladeSpecies->heightScale + rootHeight, newZ);
+
+	f32 maxBending = 0.03f*bladeSpecies->bendingScale;
+	v3f offset = V3f(maxBending*(2*texturePos.z - 1.0f), 0.0f, maxBending*(2*texturePos.w - 1.0f));
+
+	v3f centre = input->objectTransform*V3f(centrePos.x, centrePos.y + rootHeight, centrePos.z);
+	result.centrePos = V4f(centre, centrePos.w);
+
+	if (input->windActive)
+	{
+		f32 c1 = 0.65f;
+		f32 wind = sinf(c1*(f32)M_PI*centre.x + input->time);
+
+		offset.x += wind*0.12f;
+		offset.z += wind*0.16f;
+	}
+
+	v4f force = sampleReferenceImage(&input->forceMap, referenceFieldMapPos(input, pos.xyz));
+	v3f forceOffset = force.xyz*2.0f - V3f(1.0f, 1.0f, 1.0f);
+
+	newPos += centrePos.y*offset;
+	newPos += centrePos.y*hadamard(forceOffset, V3f(0.4f, 0.09f, 0.4f));
+
+	result.pos = newPos;
+	result.texturePos = V2f(texturePos.x, texturePos.y);
+	result.random = random;
+	result.species = species;
+
+	return result;
+}
+
+//---------------------------------------------------------------------------
+// grass_tess_control.glsl
+
+static inline v3f referenceControlPoint(ReferenceBladeVertex* vertices, v3f lower, v3f upper)
+{
+	// the shader only computes these in invocation 0, so they always use the first vertex's random values
+	f32 rand1 = vertices[0].centrePos.w*0.5f - 0.25f;
+	f32 rand2 = vertices[0].random.w*0.5f + 0.25f;
+
+	f32 x = lower.x*rand1 + upper.x*(1.0f - rand1);
+	f32 y = lower.y*rand2 + upper.y*(1.0f - rand2);
+	f32 z = lower.z*rand1 + upper.z*(1.0f - rand1);
+	return V3f(x, y, z);
+}
+
+static inline u32 getReferenceTessLevel(GrassReferenceInput* input, ReferenceBladeVertex* vertices)
+{
+	f32 cameraDistance = magnitude(vertices[0].centrePos.xyz - input->cameraPos);
+	f32 pixelsPerUnit = 0.5f*input->viewportHeight*input->projectionScale/cameraDistance;
+	f32 bladeLength = magnitude(vertices[1].pos - vertices[0].pos);
+	f32 bladePixels = pixelsPerUnit*bladeLength;
+
+	f32 bladeWidth = magnitude(vertices[3].pos - vertices[0].pos);
+	v3f widthDir = (vertices[3].pos - vertices[0].pos)/bladeWidth;
+	v3f viewDir = (vertices[0].centrePos.xyz - input->cameraPos)/cameraDistance;
+	f32 edgeOn = fabsf(dot(viewDir, widthDir));
+	f32 facingWidth = sqrtf(MAX(1.0f - edgeOn*edgeOn, 0.0f));
+	f32 facingPixels = pixelsPerUnit*facingWidth*bladeWidth;
+
+	u32 tessLevel = 0;
+	if (cameraDistance < REFERENCE_MAX_TESS_DISTANCE && facingPixels >= input->minFacingPixels)
+	{
+		// clamped before it's converted, a blade right at the camera covers infinitely many pixels
+		f32 segments = ceilf(bladePixels/input->pixelsPerSegment);
+		tessLevel = (u32)CLAMP_RANGE(segments, 1.0f, (f32)REFERENCE_MAX_TESS_LEVEL);
+	}
+
+	return tessLevel;
+}
+
+//---------------------------------------------------------------------------
+// grass_tess_eval.glsl, evaluated for 4 rows of the blade at a time
+
+struct ReferenceLane3
+{
+	__m128 x;
+	__m128 y;
+	__m128 z;
+};
+
+static inline ReferenceLane3 referenceLane3(v3f v)
+{
+	ReferenceLane3 result = {_mm_set1_ps(v.x), _mm_set1_ps(v.y), _mm_set1_ps(v.z)};
+	return result;
+}
+
+static inline ReferenceLane3 operator+(ReferenceLane3 left, ReferenceLane3 right)
+{
+	ReferenceLane3 result = {_mm_add_ps(left.x, right.x), _mm_add_ps(left.y, right.y), _mm_add_ps(left.z, right.z)};
+	return result;
+}
+
+static inline ReferenceLane3 operator-(ReferenceLane3 left, ReferenceLane3 right)
+{
+	ReferenceLane3 result = {_mm_sub_ps(left.x, right.x), _mm_sub_ps(left.y, right.y), _mm_sub_ps(left.z, right.z)};
+	return result;
+}
+
+static inline ReferenceLane3 operator*(ReferenceLane3 left, __m128 right)
+{
+	ReferenceLane3 result = {_mm_mul_ps(left.x, right), _mm_mul_ps(left.y, right), _mm_mul_ps(left.z, right)};
+	return result;
+}
+
+static inline ReferenceLane3 operator/(ReferenceLane3 left, __m128 right)
+{
+	ReferenceLane3 result = {_mm_div_ps(left.x, right), _mm_div_ps(left.y, right), _mm_div_ps(left.z, right)};
+	return result;
+}
+
+static inline ReferenceLane3 hadamard(ReferenceLane3 left, ReferenceLane3 right)
+{
+	ReferenceLane3 result = {_mm_mul_ps(left.x, right.x), _mm_mul_ps(left.y, right.y), _mm_mul_ps(left.z, right.z)};
+	return result;
+}
+
+static inline ReferenceLane3 cross(ReferenceLane3 v1, ReferenceLane3 v2)
+{
+	ReferenceLane3 result;
+	result.x = _mm_sub_ps(_mm_mul_ps(v1.y, v2.z), _mm_mul_ps(v1.z, v2.y));
+	result.y = _mm_sub_ps(_mm_mul_ps(v1.z, v2.x), _mm_mul_ps(v1.x, v2.z));
+	result.z = _mm_sub_ps(_mm_mul_ps(v1.x, v2.y), _mm_mul_ps(v1.y, v2.x));
+	return result;
+}
+
+static inline __m128 magnitude(ReferenceLane3 v)
+{
+	__m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v.x, v.x), _mm_mul_ps(v.y, v.y)), _mm_mul_ps(v.z, v.z));
+	return _mm_sqrt_ps(squared);
+}
+
+// one row of a transform applied to 4 points
+static inline __m128 transformLane(Matrix4f* transform, u32 row, ReferenceLane3 pos)
+{
+	f32* r = transform->elements[row];
+	__m128 result = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[0]), pos.x), _mm_mul_ps(_mm_set1_ps(r[1]), pos.y));
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(r[2]), pos.z));
+	return _mm_add_ps(result, _mm_set1_ps(r[3]));
+}
+
+struct ReferenceSpline
+{
+	ReferenceLane3 pos;
+	ReferenceLane3 tangent;
+	ReferenceLane3 a;
+};
+
+static inline ReferenceSpline referenceSplinePos(v3f p1, v3f p2, v3f p3, __m128 param)
+{
+	ReferenceSpline result;
+
+	ReferenceLane3 lane1 = referenceLane3(p1);
+	ReferenceLane3 lane2 = referenceLane3(p2);
+	ReferenceLane3 lane3 = referenceLane3(p3);
+
+	ReferenceLane3 a = lane1 + (lane2 - lane1)*param;
+	ReferenceLane3 b = lane2 + (lane3 - lane2)*param;
+
+	result.pos = a + (b - a)*param;
+	result.tangent = (b - a)/magnitude(b - a);
+	result.a = a;
+	return result;
+}
+
+// one end of a row, before it is turned into triangles
+struct ReferenceEdgeVertex
+{
+	v4f clipPos;
+	v3f worldPos;
+	v3f normal;
+};
+
+// the left and right edge vertex of every row boundary, for v = i/tessLevel
+static void evaluateReferenceEdges(Matrix4f* clipTransform, Matrix4f* objectTransform, v3f tcPos[4],
+								   v3f controlPoints[2], u32 tessLevel, ReferenceEdgeVertex* left,
+								   ReferenceEdgeVertex* right)
+{
+	__m128 laneOffsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	__m128 rowSize = _mm_set1_ps(1.0f/(f32)tessLevel);
+
+	for (u32 firstRow = 0; firstRow <= tessLevel; firstRow += 4)
+	{
+		//NOTE(denis): lanes past the last row are evaluated as well, they just aren't stored
+		__m128 v = _mm_mul_ps(_mm_add_ps(_mm_set1_ps((f32)firstRow), laneOffsets), rowSize);
+
+		ReferenceSpline leftSpline = referenceSplinePos(tcPos[0], controlPoints[0], tcPos[1], v);
+		ReferenceSpline rightSpline = referenceSplinePos(tcPos[3], controlPoints[1], tcPos[2], v);
+
+		// the shader divides by the length of a component-wise product here, which is kept so the normals match
+		ReferenceLane3 bitangent = (rightSpline.pos - leftSpline.pos) /
+			magnitude(rightSpline.pos - hadamard(leftSpline.pos, leftSpline.a));
+
+		for (u32 side = 0; side < 2; ++side)
+		{
+			ReferenceSpline* spline = side == 0 ? &leftSpline : &rightSpline;
+			ReferenceEdgeVertex* edge = side == 0 ? left : right;
+
+			ReferenceLane3 tangent = spline->tangent/magnitude(spline->tangent);
+			ReferenceLane3 normal = cross(tangent, bitangent);
+			normal = normal/magnitude(normal);
+
+			f32 values[10][4];
+			for (u32 row = 0; row < 4; ++row)
+				_mm_storeu_ps(values[row], transformLane(clipTransform, row, spline->pos));
+			for (u32 row = 0; row < 3; ++row)
+				_mm_storeu_ps(values[4 + row], transformLane(objectTransform, row, spline->pos));
+			_mm_storeu_ps(values[7], normal.x);
+			_mm_storeu_ps(values[8], normal.y);
+			_mm_storeu_ps(values[9], normal.z);
+
+			for (u32 lane = 0; lane < 4 && firstRow + lane <= tessLevel; ++lane)
+			{
+				ReferenceEdgeVertex* vertex = &edge[firstRow + lane];
+				vertex->clipPos = V4f(values[0][lane], values[1][lane], values[2][lane], values[3][lane]);
+				vertex->worldPos = V3f(values[4][lane], values[5][lane], values[6][lane]);
+				vertex->normal = V3f(values[7][lane], values[8][lane], values[9][lane]);
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+
+struct GrassReferenceJob
+{
+	GrassReferenceInput* input;
+	Matrix4f clipTransform;
+
+	GrassBlade* blades;
+	u32 bladeCount;
+
+	// room for REFERENCE_MAX_VERTICES_PER_BLADE for every blade
+	GrassReferenceVertex* vertices;
+	u32 vertexCount;
+	v3f boundsMin;
+	v3f boundsMax;
+};
+
+// returns the number of vertices written
+static u32 runReferenceBlade(GrassReferenceInput* input, Matrix4f* clipTransform, GrassBlade* blade,
+							 GrassReferenceVertex* vertices, v3f* boundsMin, v3f* boundsMax)
+{
+	ReferenceBladeVertex bladeVertices[4];
+	for (u32 i = 0; i < 4; ++i)
+	{
+		GrassBlade& b = *blade;
+		bladeVertices[i] = runReferenceVertexShader(input, b[i*4], b[i*4 + 1], b[i*4 + 2], b[i*4 + 3]);
+	}
+
+	// an outer level of 0 discards the patch
+	u32 tessLevel = getReferenceTessLevel(input, bladeVertices);
+	if (tessLevel == 0)
+		return 0;
+
+	v3f tcPos[4];
+	for (u32 i = 0; i < 4; ++i)
+		tcPos[i] = bladeVertices[i].pos;
+
+	v3f controlPoints[2];
+	controlPoints[0] = referenceControlPoint(bladeVertices, tcPos[1], tcPos[0]);
+	controlPoints[1] = referenceControlPoint(bladeVertices, tcPos[2], tcPos[3]);
+
+	ReferenceEdgeVertex left[REFERENCE_MAX_TESS_LEVEL + 1];
+	ReferenceEdgeVertex right[REFERENCE_MAX_TESS_LEVEL + 1];
+	evaluateReferenceEdges(clipTransform, &input->objectTransform, tcPos, controlPoints, tessLevel, left, right);
+
+	GrassReferenceVertex common = {};
+	common.centrePos = bladeVertices[0].centrePos.xyz;
+	common.random = bladeVertices[0].random.xyz;
+	common.species = bladeVertices[0].species;
+
+	u32 vertexCount = 0;
+	for (u32 row = 0; row < tessLevel; ++row)
+	{
+		// counter clockwise in the (u, v) domain, the same as the shader's quads
+		ReferenceEdgeVertex* corners[4] = {&left[row], &right[row], &right[row + 1], &left[row + 1]};
+		f32 cornerU[4] = {0.0f, 1.0f, 1.0f, 0.0f};
+		f32 cornerV[4] = {(f32)row/(f32)tessLevel, (f32)row/(f32)tessLevel,
+						  (f32)(row + 1)/(f32)tessLevel, (f32)(row + 1)/(f32)tessLevel};
+		u32 triangleCorners[6] = {0, 1, 2, 0, 2, 3};
+
+		for (u32 i = 0; i < 6; ++i)
+		{
+			u32 corner = triangleCorners[i];
+			ReferenceEdgeVertex* edge = corners[corner];
+			f32 u = cornerU[corner];
+			f32 v = cornerV[corner];
+
+			GrassReferenceVertex* vertex = &vertices[vertexCount++];
+			*vertex = common;
+			vertex->clipPos = edge->clipPos;
+			vertex->normal = edge->normal;
+
+			v2f a = bladeVertices[0].texturePos + (bladeVertices[3].texturePos - bladeVertices[0].texturePos)*u;
+			v2f b = bladeVertices[1].texturePos + (bladeVertices[2].texturePos - bladeVertices[1].texturePos)*u;
+			vertex->texturePos = a + (b - a)*v;
+		}
+	}
+
+	for (u32 i = 0; i <= tessLevel; ++i)
+	{
+		v3f points[2] = {left[i].worldPos, right[i].worldPos};
+		for (u32 p = 0; p < 2; ++p)
+		{
+			for (u32 axis = 0; axis < 3; ++axis)
+			{
+				boundsMin->e[axis] = MIN(boundsMin->e[axis], points[p].e[axis]);
+				boundsMax->e[axis] = MAX(boundsMax->e[axis], points[p].e[axis]);
+			}
+		}
+	}
+
+	return vertexCount;
+}
+
+// data is the array of GrassReferenceJobs
+static WORK_RANGE_CALLBACK(grassReferenceJobs)
+{
+	for (u32 jobIndex = first; jobIndex < onePastLast; ++jobIndex)
+	{
+		GrassReferenceJob* job = (GrassReferenceJob*)data + jobIndex;
+
+		job->vertexCount = 0;
+		job->boundsMin = V3f(FLT_MAX, FLT_MAX, FLT_MAX);
+		job->boundsMax = V3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		for (u32 i = 0; i < job->bladeCount; ++i)
+		{
+			job->vertexCount += runReferenceBlade(job->input, &job->clipTransform, &job->blades[i],
+												  job->vertices + job->vertexCount, &job->boundsMin, &job->boundsMax);
+		}
+	}
+}
+
+// runs the blades through the grass program's geometry stages on every core. The output is pushed onto the arena
+// and is room for the worst case, so it is only worth keeping around in a temporary
+static bool runGrassReference(Platform platform, MemoryArena* arena, GrassReferenceInput* input, GrassBlade* blades,
+							  u32 bladeCount, GrassReferenceOutput* output)
+{
+	*output = {};
+	output->boundsMin = V3f(FLT_MAX, FLT_MAX, FLT_MAX);
+	output->boundsMax = V3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	u32 bladesPerJob = MAX(REFERENCE_MIN_BLADES_PER_JOB, (bladeCount + REFERENCE_MAX_JOBS - 1)/REFERENCE_MAX_JOBS);
+	u32 jobCount = (bladeCount + bladesPerJob - 1)/bladesPerJob;
+
+	GrassReferenceVertex* vertices = TRY_PUSH_ARRAY(arena, (u64)bladeCount*REFERENCE_MAX_VERTICES_PER_BLADE,
+													GrassReferenceVertex);
+	GrassReferenceJob* jobs = TRY_PUSH_ARRAY(arena, jobCount, GrassReferenceJob);
+	if (!vertices || !jobs)
+		return false;
+
+	// the shader does this one transform at a time, so the clip positions can be off in the last bits
+	Matrix4f clipTransform = input->projectionTransform*input->viewTransform*input->objectTransform;
+
+	for (u32 i = 0; i < jobCount; ++i)
+	{
+		GrassReferenceJob* job = &jobs[i];
+		job->input = input;
+		job->clipTransform = clipTransform;
+		job->blades = blades + i*bladesPerJob;
+		job->bladeCount = MIN(bladesPerJob, bladeCount - i*bladesPerJob);
+		job->vertices = vertices + (u64)i*bladesPerJob*REFERENCE_MAX_VERTICES_PER_BLADE;
+	}
+	platform.parallelFor(platform.workQueue, jobCount, 1, grassReferenceJobs, jobs);
+
+	// every job wrote to the start of its own space, packing them together keeps the blades in order
+	output->vertices = vertices;
+	for (u32 i = 0; i < jobCount; ++i)
+	{
+		GrassReferenceJob* job = &jobs[i];
+		memmove(vertices + output->vertexCount, job->vertices, job->vertexCount*sizeof(GrassReferenceVertex));
+		output->vertexCount += job->vertexCount;
+
+		for (u32 axis = 0; axis < 3; ++axis)
+		{
+			output->boundsMin.e[axis] = MIN(output->boundsMin.e[axis], job->boundsMin.e[axis]);
+			output->boundsMax.e[axis] = MAX(output->boundsMax.e[axis], job->boundsMax.e[axis]);
+		}
+	}
+
+	return true;
+}
+
+#endif
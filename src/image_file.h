@@ -0,0 +1,255 @@
+#if !defined(IMAGE_FILE_H_)
+#define IMAGE_FILE_H_
+
+// TGA is about the simplest format that every image viewer opens: an 18 byte header and then the pixels,
+// uncompressed and bottom row first, which is the order GL reads them back in. PNG is for the tools that don't
+// open TGAs
+
+#define TGA_IMAGE_TYPE_TRUE_COLOUR 2
+// 8 bits of alpha, and the origin in the bottom left
+#define TGA_DESCRIPTOR_ALPHA_BITS 8
+
+#pragma pack(push, 1)
+struct TGAHeader
+{
+	u8 idLength;
+	u8 colourMapType;
+	u8 imageType;
+	u16 colourMapStart;
+	u16 colourMapLength;
+	u8 colourMapDepth;
+	u16 xOrigin;
+	u16 yOrigin;
+	u16 width;
+	u16 height;
+	u8 bitsPerPixel;
+	u8 descriptor;
+};
+#pragma pack(pop)
+
+static inline TGAHeader getTGAHeader(s32 width, s32 height)
+{
+	TGAHeader header = {};
+	header.imageType = TGA_IMAGE_TYPE_TRUE_COLOUR;
+	header.width = (u16)width;
+	header.height = (u16)height;
+	header.bitsPerPixel = 32;
+	header.descriptor = TGA_DESCRIPTOR_ALPHA_BITS;
+
+	return header;
+}
+
+// TGA wants BGRA, this swaps red and blue while copying
+static inline void copyRGBAToBGRA(u8* dest, u8* source, u64 pixelCount)
+{
+	for (u64 i = 0; i < pixelCount; ++i)
+	{
+		dest[i*4 + 0] = source[i*4 + 2];
+		dest[i*4 + 1] = source[i*4 + 1];
+		dest[i*4 + 2] = source[i*4 + 0];
+		dest[i*4 + 3] = source[i*4 + 3];
+	}
+}
+
+static inline u64 getTGAFileSize(s32 width, s32 height)
+{
+	return sizeof(TGAHeader) + (u64)width*height*4;
+}
+
+// dest must hold getTGAFileSize bytes, the pixels are RGBA8 with the bottom row first
+static void encodeTGA(u8* dest, u8* pixels, s32 width, s32 height)
+{
+	*(TGAHeader*)dest = getTGAHeader(width, height);
+	copyRGBAToBGRA(dest + sizeof(TGAHeader), pixels, (u64)width*height);
+}
+
+// the pixels are RGBA8 with the bottom row first, the file is staged on the arena. Returns false if the image is
+// too big for a TGA or the file couldn't be written
+static bool writeTGA(Platform platform, MemoryArena* arena, char* fileName, u8* pixels, s32 width, s32 height)
+{
+	if (width <= 0 || height <= 0 || width > 0xFFFF || height > 0xFFFF)
+		return false;
+
+	u64 fileSize = getTGAFileSize(width, height);
+	if (fileSize > 0xFFFFFFFF)
+		return false;
+
+	TemporaryMemory fileMemory = beginTemporaryMemory(arena);
+
+	bool result = false;
+	u8* file = TRY_PUSH_ARRAY(arena, fileSize, u8);
+	if (file)
+	{
+		encodeTGA(file, pixels, width, height);
+		result = platform.writeFile(fileName, file, (u32)fileSize);
+	}
+
+	endTemporaryMemory(fileMemory);
+
+	return result;
+}
+
+// PNG has to be deflated, but deflate allows "stored" blocks that are copied through as they are. That makes the
+// files as big as a TGA, but it means we can write PNGs without pulling in a compressor
+#define PNG_COLOUR_TYPE_RGBA 6
+// the most a stored deflate block can hold
+#define PNG_STORED_BLOCK_SIZE 65535
+// the most bytes that can be summed before the adler32 sums have to be wrapped
+#define ADLER32_BLOCK_SIZE 5552
+
+static u8 _pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+//NOTE(denis): a table per nibble instead of per byte, it's small enough to write out and doesn't need setting up
+static u32 _crc32NibbleTable[16] = {
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+// pass the result of a previous call as crc to keep going, the final value still has to be inverted
+static u32 updateCRC32(u32 crc, u8* data, u64 size)
+{
+	for (u64 i = 0; i < size; ++i)
+	{
+		crc ^= data[i];
+		crc = (crc >> 4) ^ _crc32NibbleTable[crc & 0xF];
+		crc = (crc >> 4) ^ _crc32NibbleTable[crc & 0xF];
+	}
+
+	return crc;
+}
+
+static inline void writeBigEndianU32(u8* dest, u32 value)
+{
+	dest[0] = (u8)(value >> 24);
+	dest[1] = (u8)(value >> 16);
+	dest[2] = (u8)(value >> 8);
+	dest[3] = (u8)value;
+}
+
+// the size of the zlib stream holding every scanline with its filter byte
+static inline u64 getPNGImageDataSize(s32 width, s32 height)
+{
+	u64 scanlineBytes = (u64)height*(1 + (u64)width*4);
+	u64 blockCount = (scanlineBytes + PNG_STORED_BLOCK_SIZE - 1)/PNG_STORED_BLOCK_SIZE;
+
+	// 2 bytes of zlib header, 5 bytes in front of every block and the adler32 at the end
+	return 2 + blockCount*5 + scanlineBytes + 4;
+}
+
+// 0 if the image can't be stored as a PNG
+static u64 getPNGFileSize(s32 width, s32 height)
+{
+	if (width <= 0 || height <= 0)
+		return 0;
+
+	u64 imageDataSize = getPNGImageDataSize(width, height);
+	if (imageDataSize > 0x7FFFFFFF)
+		return 0;
+
+	// every chunk is a length, a type, the data and a crc
+	return sizeof(_pngSignature) + (12 + 13) + (12 + imageDataSize) + 12;
+}
+
+// starts a chunk and returns where its data goes, finishPNGChunk has to be called once the data is written
+static inline u8* beginPNGChunk(u8* dest, char* type, u32 dataSize)
+{
+	writeBigEndianU32(dest, dataSize);
+	memcpy(dest + 4, type, 4);
+
+	return dest + 8;
+}
+
+// returns the end of the chunk
+static inline u8* finishPNGChunk(u8* chunkData, u32 dataSize)
+{
+	// the crc covers the type as well as the data
+	u32 crc = updateCRC32(0xFFFFFFFF, chunkData - 4, 4 + (u64)dataSize) ^ 0xFFFFFFFF;
+	writeBigEndianU32(chunkData + dataSize, crc);
+
+	return chunkData + dataSize + 4;
+}
+
+// dest must hold getPNGFileSize bytes, the pixels are RGBA8 with the bottom row first
+static void encodePNG(u8* dest, u8* pixels, s32 width, s32 height)
+{
+	memcpy(dest, _pngSignature, sizeof(_pngSignature));
+	u8* at = dest + sizeof(_pngSignature);
+
+	u8* header = beginPNGChunk(at, "IHDR", 13);
+	writeBigEndianU32(header, (u32)width);
+	writeBigEndianU32(header + 4, (u32)height);
+	header[8] = 8;
+	header[9] = PNG_COLOUR_TYPE_RGBA;
+	// compression, filter and interlace methods are all the default
+	header[10] = 0;
+	header[11] = 0;
+	header[12] = 0;
+	at = finishPNGChunk(header, 13);
+
+	u32 imageDataSize = (u32)getPNGImageDataSize(width, height);
+	u8* imageData = beginPNGChunk(at, "IDAT", imageDataSize);
+
+	u8* zlib = imageData;
+	// deflate with a 32K window and no dictionary, the check bits make the header a multiple of 31
+	*zlib++ = 0x78;
+	*zlib++ = 0x01;
+
+	u64 rowBytes = (u64)width*4;
+	u64 scanlineBytes = (u64)height*(1 + rowBytes);
+	u64 blockRemaining = 0;
+
+	u32 adlerA = 1;
+	u32 adlerB = 0;
+	u32 adlerCount = 0;
+
+	// PNG is stored top row first, so the rows are walked backwards. Bytes go into the blocks one at a time, which
+	// is simpler than lining rows up with the block boundaries and still nowhere near as slow as writing the file
+	u64 written = 0;
+	for (s32 row = height - 1; row >= 0; --row)
+	{
+		u8* rowPixels = pixels + (u64)row*rowBytes;
+
+		for (u64 i = 0; i <= rowBytes; ++i)
+		{
+			if (blockRemaining == 0)
+			{
+				u64 blockSize = MIN(scanlineBytes - written, (u64)PNG_STORED_BLOCK_SIZE);
+				bool finalBlock = written + blockSize == scanlineBytes;
+
+				*zlib++ = finalBlock ? 1 : 0;
+				*zlib++ = (u8)blockSize;
+				*zlib++ = (u8)(blockSize >> 8);
+				*zlib++ = (u8)~blockSize;
+				*zlib++ = (u8)(~blockSize >> 8);
+
+				blockRemaining = blockSize;
+			}
+
+			// every scanline starts with its filter type, 0 for none
+			u8 value = i == 0 ? 0 : rowPixels[i - 1];
+			*zlib++ = value;
+			--blockRemaining;
+			++written;
+
+			adlerA += value;
+			adlerB += adlerA;
+			if (++adlerCount == ADLER32_BLOCK_SIZE)
+			{
+				adlerA %= 65521;
+				adlerB %= 65521;
+				adlerCount = 0;
+			}
+		}
+	}
+
+	adlerA %= 65521;
+	adlerB %= 65521;
+	writeBigEndianU32(zlib, (adlerB << 16) | adlerA);
+
+	at = finishPNGChunk(imageData, imageDataSize);
+
+	u8* end = beginPNGChunk(at, "IEND", 0);
+	finishPNGChunk(end, 0);
+}
+
+#endif
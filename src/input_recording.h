@@ -0,0 +1,122 @@
+#if !defined(INPUT_RECORDING_H_)
+#define INPUT_RECORDING_H_
+
+// Recording file layout:
+//  InputRecordingHeader
+//  for every frame:
+//   u8 flags
+//   f32 frame delta in seconds
+//   Input (only when INPUT_FRAME_CHANGED is set, otherwise the previous frame's input is repeated)
+//
+//NOTE(denis): Input is written out as raw bytes, so a recording can only be replayed by a build with the same
+// Input layout. inputSize in the header is used to catch that.
+
+#define INPUT_RECORDING_MAGIC 0x52494752 // "RGIR"
+#define INPUT_RECORDING_VERSION 2
+
+// this is the seed the CRT starts with, so recording doesn't change the blades you would have gotten anyway
+#define INPUT_RECORDING_RANDOM_SEED 1
+
+#define INPUT_FRAME_CHANGED 0x1
+
+struct InputRecordingHeader
+{
+	u32 magic;
+	u32 version;
+	u32 inputSize;
+	u32 randomSeed;
+
+	u32 windowWidth;
+	u32 windowHeight;
+
+	char forceMapFile[64];
+};
+
+struct InputPlayback
+{
+	u8* data;
+	u64 dataSize;
+	u64 readOffset;
+
+	InputRecordingHeader header;
+	Input currentInput;
+
+	u32 framesPlayed;
+};
+
+// writes the frame record into buffer (which must hold at least INPUT_FRAME_MAX_SIZE bytes), returns its size
+#define INPUT_FRAME_MAX_SIZE (sizeof(u8) + sizeof(f32) + sizeof(Input))
+static u32 encodeInputFrame(u8* buffer, Input* input, Input* previousInput, f32 frameDelta)
+{
+	u32 size = 0;
+
+	u8 flags = 0;
+	if (!previousInput || memcmp(input, previousInput, sizeof(Input)) != 0)
+		flags |= INPUT_FRAME_CHANGED;
+
+	buffer[size] = flags;
+	size += sizeof(u8);
+
+	memcpy(buffer + size, &frameDelta, sizeof(f32));
+	size += sizeof(f32);
+
+	if (flags & INPUT_FRAME_CHANGED)
+	{
+		memcpy(buffer + size, input, sizeof(Input));
+		size += sizeof(Input);
+	}
+
+	return size;
+}
+
+// data is the full contents of a recording file, returns false if it isn't a recording we can play
+static bool beginInputPlayback(InputPlayback* playback, void* data, u64 dataSize)
+{
+	*playback = {};
+
+	if (!data || dataSize < sizeof(InputRecordingHeader))
+		return false;
+
+	memcpy(&playback->header, data, sizeof(InputRecordingHeader));
+	if (playback->header.magic != INPUT_RECORDING_MAGIC ||
+		playback->header.version != INPUT_RECORDING_VERSION ||
+		playback->header.inputSize != sizeof(Input))
+	{
+		return false;
+	}
+
+	playback->data = (u8*)data;
+	playback->dataSize = dataSize;
+	playback->readOffset = sizeof(InputRecordingHeader);
+
+	return true;
+}
+
+// returns false once every recorded frame has been played
+static bool playNextInputFrame(InputPlayback* playback, Input* input, f32* frameDelta)
+{
+	u64 frameHeaderSize = sizeof(u8) + sizeof(f32);
+	if (playback->readOffset + frameHeaderSize > playback->dataSize)
+		return false;
+
+	u8 flags = playback->data[playback->readOffset];
+	memcpy(frameDelta, playback->data + playback->readOffset + sizeof(u8), sizeof(f32));
+
+	u64 frameSize = frameHeaderSize;
+	if (flags & INPUT_FRAME_CHANGED)
+	{
+		if (playback->readOffset + frameHeaderSize + sizeof(Input) > playback->dataSize)
+			return false;
+
+		memcpy(&playback->currentInput, playback->data + playback->readOffset + frameHeaderSize, sizeof(Input));
+		frameSize += sizeof(Input);
+	}
+
+	playback->readOffset += frameSize;
+	++playback->framesPlayed;
+
+	*input = playback->currentInput;
+	return true;
+}
+
+#endif
@@ -1,45 +1,211 @@
 #include "platform_layer.h"
 
-#include <vector>
-
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "texture_container.h"
 #include "main.h"
+#include "grass_reference.h"
+#include "grass_rasterizer.h"
+#include "reference_check.h"
+#include "image_file.h"
+
+static char* _groundShaderFiles[SHADER_STAGE_COUNT] = {GROUND_VERTEX_SHADER, GROUND_FRAGMENT_SHADER, 0, 0};
+static char* _grassShaderFiles[SHADER_STAGE_COUNT] = {
+	GRASS_VERTEX_SHADER, GRASS_FRAGMENT_SHADER, GRASS_TESS_CONTROL_SHADER, GRASS_TESS_EVAL_SHADER
+};
+// the tess eval shader's outputs in the order of GrassReferenceVertex's members
+static char* _grassCaptureVaryings[] = {
+	"gl_Position", "teCentrePos", "teNormal", "teTexturePos", "teRandom", "teSpecies"
+};
+
+// the layers of the alpha and diffuse texture arrays, in the order BladeSpecies refers to them
+static char* _alphaTextureFiles[] = {"grass_alpha_texture.png", "leaf_alpha_texture.png"};
+static char* _diffuseTextureFiles[] = {"grass_diffuse_texture.jpg"};
+
+//NOTE(denis): indexed by the vegetation map, so its darkest range is the short grass
+static BladeSpecies _bladeSpecies[BLADE_SPECIES_COUNT] = {
+	// short grass
+	{0, 0, 1.0f, 0.7f, 0.8f, {0.8f, 0.9f, 0.8f}, {1.0f, 1.1f, 0.9f}},
+	// tall dry grass
+	{0, 0, 0.8f, 1.4f, 1.3f, {0.9f, 0.9f, 0.7f}, {1.4f, 1.2f, 0.6f}},
+	// broad leaves
+	{1, 0, 3.0f, 0.6f, 0.5f, {0.6f, 0.8f, 0.5f}, {0.8f, 1.0f, 0.6f}},
+};
+
+static RandomSeries createRandomSeries(u32 seed)
+{
+	RandomSeries result;
+	// scrambling the seed so that nearby seeds don't start out with similar numbers
+	result.state = seed*2654435761u ^ 0x9E3779B9u;
+	// xorshift never leaves 0
+	if (result.state == 0)
+		result.state = 1;
+
+	return result;
+}
 
 // returns a random number in range [0.0, 1.0]
-static f32 getRandom()
+//NOTE(denis): rand() keeps its state per thread in the CRT, so anything that runs in a job needs its own series
+// to stay deterministic
+static f32 getRandom(RandomSeries* series)
 {
-	return (f32)rand() / (f32)RAND_MAX;
+	u32 x = series->state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	series->state = x;
+
+	return (f32)(x >> 8) / (f32)0xFFFFFF;
 }
 
-static void drawGrassField(Matrix4f transform, u32 transformUniform, u32 patchPosUniform, u32 numElements, u32 type)
+// picks the level of detail for a terrain patch from how far its closest point could be from the camera
+static u32 getTerrainLOD(v3f patchCentre, v3f cameraPos)
 {
-    v3f origin = transform.getTranslation();
-	Matrix4f newTransform = transform;
-	
+	// half the diagonal of a patch
+	f32 patchRadius = 0.71f;
+	f32 distance = MAX(magnitude(cameraPos - patchCentre) - patchRadius, 0.0f);
+
+	return MIN((u32)(distance/TERRAIN_LOD_DISTANCE), TERRAIN_LOD_COUNT - 1);
+}
+
+// where the patch in column col and row row of the field is drawn, patchPos is what the shaders get for it
+static Matrix4f getPatchTransform(Matrix4f fieldTransform, s32 col, s32 row, v2f* patchPos)
+{
+	*patchPos = V2f(-0.5f + col*1.0f, -0.5f + row*1.0f);
+
+	v3f origin = fieldTransform.getTranslation();
+	Matrix4f result = fieldTransform;
+	result.setTranslation(origin.x + col, origin.y, origin.z + row);
+
+	return result;
+}
+
+// a world space box around everything drawn for the patch, the ground and its blades
+static void getPatchBounds(Matrix4f patchTransform, v3f* boundsMin, v3f* boundsMax)
+{
+	f32 halfWidth = 0.5f + PATCH_BLADE_REACH;
+	v3f localMin = V3f(-halfWidth, -TERRAIN_SKIRT_DEPTH, -halfWidth);
+	v3f localMax = V3f(halfWidth, TERRAIN_HEIGHT_SCALE + PATCH_BLADE_HEIGHT, halfWidth);
+
+	for (u32 i = 0; i < 8; ++i)
+	{
+		v3f corner = V3f((i & 1) ? localMax.x : localMin.x,
+						 (i & 2) ? localMax.y : localMin.y,
+						 (i & 4) ? localMax.z : localMin.z);
+		v3f worldCorner = patchTransform*corner;
+
+		if (i == 0)
+		{
+			*boundsMin = worldCorner;
+			*boundsMax = worldCorner;
+		}
+		else
+		{
+			*boundsMin = V3f(MIN(boundsMin->x, worldCorner.x), MIN(boundsMin->y, worldCorner.y),
+							 MIN(boundsMin->z, worldCorner.z));
+			*boundsMax = V3f(MAX(boundsMax->x, worldCorner.x), MAX(boundsMax->y, worldCorner.y),
+							 MAX(boundsMax->z, worldCorner.z));
+		}
+	}
+}
+
+// the planes of the frustum clipTransform (projection*view) projects into clip space
+static Frustum getFrustum(Matrix4f clipTransform)
+{
+	Frustum result;
+
+	v4f rows[4];
+	for (u32 i = 0; i < 4; ++i)
+		rows[i] = V4f(clipTransform[i][0], clipTransform[i][1], clipTransform[i][2], clipTransform[i][3]);
+
+	// -w <= x <= w and so on for y and z
+	for (u32 axis = 0; axis < 3; ++axis)
+	{
+		result.planes[axis*2] = rows[3] + rows[axis];
+		result.planes[axis*2 + 1] = rows[3] - rows[axis];
+	}
+
+	return result;
+}
+
+// false only when the whole box is outside one of the planes, so boxes near a corner of the frustum can still
+// get through
+static bool boxInFrustum(Frustum* frustum, v3f boundsMin, v3f boundsMax)
+{
+	for (u32 i = 0; i < ARRAY_COUNT(frustum->planes); ++i)
+	{
+		v4f plane = frustum->planes[i];
+
+		// the corner of the box furthest along the plane's normal
+		v3f corner = V3f(plane.x >= 0.0f ? boundsMax.x : boundsMin.x,
+						 plane.y >= 0.0f ? boundsMax.y : boundsMin.y,
+						 plane.z >= 0.0f ? boundsMax.z : boundsMin.z);
+
+		if (plane.x*corner.x + plane.y*corner.y + plane.z*corner.z + plane.w < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+// fills in the patches of the field that are inside the frustum clipTransform (projection*view) projects, and
+// returns how many there are. Each one picks its own terrain level of detail
+static u32 cullField(Matrix4f fieldTransform, Matrix4f clipTransform, v3f cameraPos, PatchDraw* patches)
+{
+	Frustum frustum = getFrustum(clipTransform);
+	u32 patchCount = 0;
+
 	//TODO(denis): will need to not be hardcoded if want to support over 9 patches
 	for (s32 row = -1; row <= 1; ++row)
 	{
 		for (s32 col = -1; col <= 1; ++col)
 		{
-			v2f patchPos = {-0.5f + col*1.0f, -0.5f + row*1.0f};
-			
-			newTransform.setTranslation(origin.x + col, origin.y, origin.z + row);
-			glUniformMatrix4fv(transformUniform, 1, GL_TRUE,  (f32*)newTransform.elements);
-			glUniform2fv(patchPosUniform, 1, (f32*)patchPos.e);
-
-			if (type == GL_PATCHES)
-				glDrawArrays(GL_PATCHES, 0, numElements);
-			else if (type == GL_TRIANGLES)
-				glDrawElements(GL_TRIANGLES, numElements, GL_UNSIGNED_INT, 0);
+			PatchDraw patch;
+			patch.transform = getPatchTransform(fieldTransform, col, row, &patch.patchPos);
+
+			v3f boundsMin, boundsMax;
+			getPatchBounds(patch.transform, &boundsMin, &boundsMax);
+			if (!boxInFrustum(&frustum, boundsMin, boundsMax))
+				continue;
+
+			patch.terrainLOD = getTerrainLOD(patch.transform.getTranslation(), cameraPos);
+			patches[patchCount++] = patch;
+		}
+	}
+
+	return patchCount;
+}
+
+// returns the number of patches that were drawn. The terrain is drawn with the same patches as the grass, and
+// when it's given each patch uses its own level of detail (type has to be GL_TRIANGLES then)
+static u32 drawGrassField(PatchDraw* patches, u32 patchCount, u32 transformUniform, u32 patchPosUniform,
+						  u32 numElements, u32 type, TerrainMesh* terrain = 0)
+{
+	for (u32 i = 0; i < patchCount; ++i)
+	{
+		PatchDraw* patch = &patches[i];
+
+		glUniformMatrix4fv(transformUniform, 1, GL_TRUE,  (f32*)patch->transform.elements);
+		glUniform2fv(patchPosUniform, 1, (f32*)patch->patchPos.e);
+
+		if (terrain)
+		{
+			numElements = terrain->indexCounts[patch->terrainLOD];
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrain->indexBuffers[patch->terrainLOD]);
 		}
+
+		if (type == GL_PATCHES)
+			glDrawArrays(GL_PATCHES, 0, numElements);
+		else if (type == GL_TRIANGLES)
+			glDrawElements(GL_TRIANGLES, numElements, GL_UNSIGNED_INT, 0);
 	}
+
+	return patchCount;
 }
 
 //TODO(denis): implement density map
-// returns the number of vertices generated
-static u32 generateGrassPatch(v3f grassPlane[4], std::vector<GrassBlade>* blades)
+static u32 generateGrassPatch(v3f grassPlane[4], RandomSeries* random, GrassBlade* blades, u32 numBlades)
 {
 	// these values were played around with until something that looked "right" was found
 	// ideally, we would read these values from the density map (or at least the height)
@@ -50,23 +216,22 @@ static u32 generateGrassPatch(v3f grassPlane[4], std::vector<GrassBlade>* blades
 	f32 maxHeight = 0.125f;
 
 	//TODO(denis): read from density map
-	u32 numBladesToGenerate = NUM_BLADES_TO_GENERATE;
-	for (u32 i = 0; i < numBladesToGenerate; ++i)
+	for (u32 i = 0; i < numBlades; ++i)
 	{
 		// these are passed to the GPU to give variety to grass blades
 		f32 randomValues[8];
 		for (u32 randIndex = 0; randIndex < 8; ++randIndex)
-			randomValues[randIndex] = getRandom();
+			randomValues[randIndex] = getRandom(random);
 			
-		f32 width = minWidth + getRandom()*(maxWidth - minWidth);
-		f32 height = minHeight + getRandom()*(maxHeight - minHeight); //TODO(denis): multiply by density map value
+		f32 width = minWidth + getRandom(random)*(maxWidth - minWidth);
+		f32 height = minHeight + getRandom(random)*(maxHeight - minHeight); //TODO(denis): multiply by density map value
 
 		//TODO(denis): use a better random distribution, some kind of noise function?
-		f32 x = getRandom() - 0.5f;
-		f32 z = getRandom() - 0.5f;
+		f32 x = getRandom(random) - 0.5f;
+		f32 z = getRandom(random) - 0.5f;
 		v4f bladeCentre = V4f(x, grassPlane[0].y, z, randomValues[0]);
 
-		GrassBlade blade;
+		GrassBlade& blade = blades[i];
 
 		// setting quad vertices
 		blade[0] = bladeCentre - V4f(0.5f*width, 0.0f, 0.0f, 0.0f);
@@ -98,11 +263,14 @@ static u32 generateGrassPatch(v3f grassPlane[4], std::vector<GrassBlade>* blades
 		blade[7] = randomVector;
 		blade[11] = randomVector;
 		blade[15] = randomVector;
-
-	    blades->push_back(blade);		
 	}
 
-	return (u32)blades->size()*4;
+	return numBlades*4;
+}
+
+static inline u32 getBladeChunkSize(u32 chunkIndex)
+{
+	return MIN(BLADES_PER_CHUNK, NUM_BLADES_TO_GENERATE - chunkIndex*BLADES_PER_CHUNK);
 }
 
 static Matrix4f calculateProjectionMatrix(f32 near, f32 far, f32 fov, f32 aspectRatioX, f32 aspectRatioY)
@@ -145,15 +313,9 @@ static Matrix4f calculateViewMatrix(Camera* camera)
 	return viewMatrix;
 }
 
-static Matrix4f getProjectionTransform(Camera* camera)
+static Matrix4f getProjectionTransform(Camera* camera, u32 screenWidth, u32 screenHeight)
 {
 	Matrix4f result;
-	
-	s32 params[4];
-	glGetIntegerv(GL_VIEWPORT, params);
-
-	u32 screenWidth = params[2];
-	u32 screenHeight = params[3];
 
 	f32 aspectRatioX = 1.0f;
 	f32 aspectRatioY = 1.0f;
@@ -165,9 +327,38 @@ static Matrix4f getProjectionTransform(Camera* camera)
 	result = calculateProjectionMatrix(camera->near, camera->far, camera->fov, aspectRatioX, aspectRatioY);
 	return result;
 }
+static inline Matrix4f getProjectionTransform(Camera* camera)
+{
+	s32 params[4];
+	glGetIntegerv(GL_VIEWPORT, params);
+
+	return getProjectionTransform(camera, params[2], params[3]);
+}
+
+// the off-axis part of the projection that lands in the rectangle [left, right] x [bottom, top] of normalized
+// device coordinates, stretched out to cover all of them. A grid of these renders the same image in pieces
+static Matrix4f getSubProjection(Matrix4f projection, f32 left, f32 right, f32 bottom, f32 top)
+{
+	Matrix4f result = projection;
+
+	f32 scaleX = 2.0f/(right - left);
+	f32 offsetX = -(right + left)/(right - left);
+	f32 scaleY = 2.0f/(top - bottom);
+	f32 offsetY = -(top + bottom)/(top - bottom);
+
+	// scaling and offsetting x/w and y/w is the same as doing it to x and y and adding some of w
+	for (u32 col = 0; col < 4; ++col)
+	{
+		result[0][col] = scaleX*projection[0][col] + offsetX*projection[3][col];
+		result[1][col] = scaleY*projection[1][col] + offsetY*projection[3][col];
+	}
+
+	return result;
+}
 
+// viewportHeight is in pixels, the grass picks its tessellation levels from how big the blades are on screen
 static void updateShaderTransforms(Matrix4f projection, Matrix4f view, Matrix4f object, Camera* camera,
-								   ShaderInfo* shaderInfo)
+								   s32 viewportHeight, ShaderInfo* shaderInfo)
 {
 	Matrix4f worldTransform = projection*view*object;
 
@@ -184,261 +375,1767 @@ static void updateShaderTransforms(Matrix4f projection, Matrix4f view, Matrix4f
 	glUniformMatrix4fv(shaderInfo->grassProjectionTransform, 1, GL_TRUE, (f32*)projection.elements);
 
 	glUniform3fv(shaderInfo->cameraPos, 1, (f32*)&camera->pos);
+	glUniform1f(shaderInfo->viewportHeight, (f32)viewportHeight);
+	glUniform1f(shaderInfo->projectionScale, projection[1][1]);
 }
 
-static u32 createTexture(char* textureFile, u32 textureUnit)
+// sets the sampling state of the texture bound to target
+static void setTextureFiltering(GLenum target, u32 levelCount)
 {
-	u32 textureID = 0;
-	
-	s32 width, height, numComponents;
-	u8* textureData = stbi_load(textureFile, &width, &height, &numComponents, 4);
-	ASSERT(textureData);
-	
-	glGenTextures(1, &textureID);
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_2D, textureID);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureData);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
 
-	stbi_image_free(textureData);
+	if (levelCount > 1)
+	{
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 
-	return textureID;
+		if (MAX_TEXTURE_ANISOTROPY > 1.0f && hasGLExtension("GL_EXT_texture_filter_anisotropic"))
+		{
+			f32 maxAnisotropy = 1.0f;
+			glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+			glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, MIN(maxAnisotropy, MAX_TEXTURE_ANISOTROPY));
+		}
+	}
+	else
+	{
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	}
 }
 
-APP_INIT_CALL(appInit)
+static u32 getMipLevelCount(s32 width, s32 height)
 {
-	ShaderInfo* shaderInfo = &memory->shaderInfo;
-	shaderInfo->groundProgram = initShaders(platform, "../shaders/ground_vertex.glsl", "../shaders/ground_fragment.glsl", 0, 0);
+	u32 result = 1;
+	while (width > 1 || height > 1)
+	{
+		width = MAX(width/2, 1);
+		height = MAX(height/2, 1);
+		++result;
+	}
 
-	// the plane on which all of the grass blades are drawn
-	v3f grassPlane[4];
-    grassPlane[0] = V3f(-0.5f, 0.0f, -0.5f);
-	grassPlane[1] = V3f(0.5f, 0.0f, -0.5f);
-	grassPlane[2] = V3f(0.5f, 0.0f, 0.5f);
-	grassPlane[3] = V3f(-0.5f, 0.0f, 0.5f);
+	return result;
+}
 
-	v3 planeTriangles[2];
-	planeTriangles[0] = V3(2, 1, 0);
-	planeTriangles[1] = V3(2, 0, 3);
+// maps a texture written by texture_converter, returns false if the file is missing or malformed.
+// The levels are uploaded straight out of the mapping, so it stays mapped until the texture is freed
+static bool readTextureContainer(Platform platform, char* containerFile, TextureData* texture)
+{
+	MappedFile container;
+	if (!platform.mapFile(containerFile, &container))
+		return false;
 
-	glGenVertexArrays(1, &memory->groundVAO);
-	glBindVertexArray(memory->groundVAO);
+	u8* fileData = (u8*)container.data;
+	u64 fileSize = container.size;
 
-	createVertexBuffer(grassPlane, 4);
-	createElementBuffer(planeTriangles, 2);
-	
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(v3f), 0);
-	glEnableVertexAttribArray(0);
+	TextureContainerHeader* header = (TextureContainerHeader*)fileData;
+	TextureLevel* levels = (TextureLevel*)(fileData + sizeof(TextureContainerHeader));
 
-	Camera* camera = &memory->camera;
-	camera->fov= CAMERA_FOV;
-	camera->pos = V3f(0.0f, 3.0f, 5.0f);
-	camera->target = V3f(0.0f, 0.0f, 0.0f);
-	camera->upDir = V3f(0.0f, 1.0f, 0.0f);
-	camera->near = NEAR_PLANE;
-	camera->far = FAR_PLANE;
+	bool valid = fileSize >= sizeof(TextureContainerHeader) &&
+		header->magic == TEXTURE_CONTAINER_MAGIC && header->version == TEXTURE_CONTAINER_VERSION &&
+		header->format < TEXTURE_FORMAT_COUNT &&
+		header->levelCount > 0 && header->levelCount <= TEXTURE_MAX_LEVELS &&
+		sizeof(TextureContainerHeader) + header->levelCount*sizeof(TextureLevel) <= fileSize;
 
-	memory->viewTransform = calculateViewMatrix(camera);
-	memory->projectionTransform = getProjectionTransform(camera);
+	for (u32 i = 0; valid && i < header->levelCount; ++i)
+	{
+		TextureLevel* level = &levels[i];
+		valid = level->size == getTextureLevelSize((TextureFormat)header->format, level->width, level->height) &&
+			(u64)level->offset + level->size <= fileSize;
+	}
 
-	memory->objectTransform = M4f();
+	if (!valid)
+	{
+		platform.debugOutput(containerFile);
+		platform.debugOutput(" is not a valid texture container, decoding the source image instead\n");
+		platform.unmapFile(&container);
+		return false;
+	}
 
-	//TODO(denis): these are now the exact same as the grass transforms, so there is probably a way to simplify this
-	shaderInfo->groundObjectTransform = glGetUniformLocation(shaderInfo->groundProgram, "object");
-	shaderInfo->groundViewTransform = glGetUniformLocation(shaderInfo->groundProgram, "view");
-	shaderInfo->groundProjectionTransform = glGetUniformLocation(shaderInfo->groundProgram, "projection");
+	*texture = {};
+	texture->format = (TextureFormat)header->format;
+	texture->levelCount = header->levelCount;
+	for (u32 i = 0; i < header->levelCount; ++i)
+	{
+		texture->levels[i] = levels[i];
+		texture->levelData[i] = fileData + levels[i].offset;
+	}
+	texture->container = container;
 
-	glUniformMatrix4fv(shaderInfo->groundObjectTransform, 1, GL_TRUE, (f32*)memory->objectTransform.elements);
-	glUniformMatrix4fv(shaderInfo->groundViewTransform, 1, GL_TRUE, (f32*)memory->viewTransform.elements);
-	glUniformMatrix4fv(shaderInfo->groundProjectionTransform, 1, GL_TRUE, (f32*)memory->projectionTransform.elements);
+	return true;
+}
 
-	std::vector<GrassBlade> blades;
-	memory->numBladeVertices = generateGrassPatch(grassPlane, &blades);
-	
-	shaderInfo->grassProgram = initShaders(platform, "../shaders/grass_vertex.glsl", "../shaders/grass_fragment.glsl",
-										   "../shaders/grass_tess_control.glsl", "../shaders/grass_tess_eval.glsl");
+// decodes the image to RGBA8 (R8 for masks), the mask mips are built here in the arena but the driver is left to
+// build any other mips
+static bool decodeTexture(MemoryArena* arena, char* imageFile, u32 flags, TextureData* texture)
+{
+	*texture = {};
 
-	// each quad is a patch
-	glPatchParameteri(GL_PATCH_VERTICES, 4);
-	
-	glGenVertexArrays(1, &memory->grassVAO);
-	glBindVertexArray(memory->grassVAO);
+	// masks only need the one channel, stb_image turns colour into grey for us
+	bool mask = (flags & TEXTURE_COVERAGE_MASK) != 0;
+	s32 componentCount = mask ? 1 : 4;
 
-	u32 componentsPerBlade = sizeof(GrassBlade) / sizeof(v4f);
-	createVertexBuffer((v4f*)(&blades[0]), (u32)blades.size() * componentsPerBlade);
+	s32 width, height, numComponents;
+	u8* pixels = stbi_load(imageFile, &width, &height, &numComponents, componentCount);
+	if (!pixels)
+		return false;
+
+	texture->format = mask ? TEXTURE_FORMAT_R8 : TEXTURE_FORMAT_RGBA8;
+	texture->decodedPixels = pixels;
+	texture->levelCount = 1;
+	texture->levels[0].width = width;
+	texture->levels[0].height = height;
+	texture->levels[0].size = width*height*componentCount;
+	texture->levelData[0] = pixels;
+
+	if ((flags & TEXTURE_MIPMAPPED) && mask)
+	{
+		u32 levelCount = MIN(getMipLevelCount(width, height), TEXTURE_MAX_LEVELS);
 
-	u32 vertexStride = sizeof(v4f)*4;
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, vertexStride, 0);
-	glEnableVertexAttribArray(0);
+		u32 mipmapBytes = 0;
+		for (u32 i = 1; i < levelCount; ++i)
+		{
+			TextureLevel* level = &texture->levels[i];
+			level->width = MAX(texture->levels[i-1].width/2, 1);
+			level->height = MAX(texture->levels[i-1].height/2, 1);
+			level->size = level->width*level->height*componentCount;
+			mipmapBytes += level->size;
+		}
 
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, vertexStride, (void*)sizeof(v4f));
-	glEnableVertexAttribArray(1);
+		u8* levelPixels = TRY_PUSH_ARRAY(arena, mipmapBytes, u8);
+		if (!levelPixels)
+			return true;
 
-	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, vertexStride, (void*)(sizeof(v4f)*2));
-	glEnableVertexAttribArray(2);
+		f32 coverage = getMaskCoverage(pixels, width, height, componentCount);
 
-	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, vertexStride, (void*)(sizeof(v4f)*3));
-	glEnableVertexAttribArray(3);
+		for (u32 i = 1; i < levelCount; ++i)
+		{
+			TextureLevel* previous = &texture->levels[i-1];
+			TextureLevel* level = &texture->levels[i];
 
-	shaderInfo->grassObjectTransform = glGetUniformLocation(shaderInfo->grassProgram, "objectTransform");
-	shaderInfo->grassViewTransform = glGetUniformLocation(shaderInfo->grassProgram, "viewTransform");
-	shaderInfo->grassProjectionTransform = glGetUniformLocation(shaderInfo->grassProgram, "projectionTransform");
+			//NOTE(denis): always filtering from the thresholded level above so each level stays a mask of the last one
+			downsampleTexture(texture->levelData[i-1], previous->width, previous->height,
+							  levelPixels, level->width, level->height, componentCount);
+			thresholdMaskLevel(levelPixels, level->width, level->height, componentCount, coverage);
 
-	glUniformMatrix4fv(shaderInfo->grassObjectTransform, 1, GL_TRUE, (f32*)memory->objectTransform.elements);
-	glUniformMatrix4fv(shaderInfo->grassViewTransform, 1, GL_TRUE, (f32*)memory->viewTransform.elements);
-	glUniformMatrix4fv(shaderInfo->grassProjectionTransform, 1, GL_TRUE, (f32*)memory->projectionTransform.elements);
+			texture->levelData[i] = levelPixels;
+			levelPixels += level->size;
+		}
 
-	shaderInfo->cameraPos = glGetUniformLocation(shaderInfo->grassProgram, "cameraPos");
-	glUniform3fv(shaderInfo->cameraPos, 1, (f32*)&camera->pos);
+		texture->levelCount = levelCount;
+	}
+	else if (flags & TEXTURE_MIPMAPPED)
+	{
+		texture->generateMipmaps = true;
+	}
 
-	shaderInfo->time = glGetUniformLocation(shaderInfo->grassProgram, "time");
-	shaderInfo->windActive = glGetUniformLocation(shaderInfo->grassProgram, "windActive");
-	shaderInfo->patchPos = glGetUniformLocation(shaderInfo->grassProgram, "patchPos");
+	return true;
+}
 
-	u32 fieldOrigin = glGetUniformLocation(shaderInfo->grassProgram, "fieldRect");
-	//TODO(denis): assumes the 9 square system is how the patches are organized
-	v3f fieldRect[2] = {grassPlane[0] - V3f(1.0f, 0.0f, 1.0f),
-						grassPlane[2] + V3f(1.0f, 0.0f, 1.0f)};
-	glUniform3fv(fieldOrigin, 2, (f32*)&fieldRect[0]);
+//NOTE(denis): stb_image does its own allocation, the mask mips are freed with the load's arena
+static void freeTextureData(Platform platform, TextureData* texture)
+{
+	platform.unmapFile(&texture->container);
+	if (texture->decodedPixels)
+		stbi_image_free(texture->decodedPixels);
 
-	glEnable(GL_DEPTH_TEST);
+	*texture = {};
+}
 
-	memory->oldController = {};
-	memory->lastMousePos = V2(-1, -1);
-	memory->windActive = 0;
+// uses the preprocessed container next to the image when there is one, otherwise decodes the image itself.
+//NOTE(denis): doesn't touch GL, so this is safe to run in a job
+static void readTexture(Platform platform, MemoryArena* arena, char* imageFile, u32 flags, TextureData* texture)
+{
+	char containerFile[MAX_PATH_LENGTH];
 
-	// setting up textures
-	memory->alphaTexture = createTexture("grass_alpha_texture.png", GL_TEXTURE0);
-	u32 textureUniform = glGetUniformLocation(shaderInfo->grassProgram, "alphaTexture");
-	glUniform1i(textureUniform, 0);
+	u32 nameLength = 0;
+	u32 extensionStart = 0;
+	for (; imageFile[nameLength] != 0 && nameLength < MAX_PATH_LENGTH; ++nameLength)
+	{
+		char c = imageFile[nameLength];
+		containerFile[nameLength] = c;
+
+		if (c == '.')
+			extensionStart = nameLength;
+		else if (c == '/' || c == '\\')
+			extensionStart = 0;
+	}
+	if (extensionStart == 0)
+		extensionStart = nameLength;
 
-	memory->diffuseTexture = createTexture("grass_diffuse_texture.jpg", GL_TEXTURE1);
-	textureUniform = glGetUniformLocation(shaderInfo->grassProgram, "diffuseTexture");
-	glUniform1i(textureUniform, 1);
+	bool loaded = false;
+	if (imageFile[nameLength] == 0 && extensionStart + sizeof(TEXTURE_CONTAINER_EXTENSION) <= MAX_PATH_LENGTH)
+	{
+		copyIntoString(containerFile + extensionStart, TEXTURE_CONTAINER_EXTENSION);
+		containerFile[extensionStart + sizeof(TEXTURE_CONTAINER_EXTENSION) - 1] = 0;
+		loaded = readTextureContainer(platform, containerFile, texture);
+	}
 
-	memory->forceMap = createTexture(forceMapFile, GL_TEXTURE2);
-	textureUniform = glGetUniformLocation(shaderInfo->grassProgram, "forceMap");
-	glUniform1i(textureUniform, 2);
+	if (!loaded)
+		decodeTexture(arena, imageFile, flags, texture);
 }
 
-APP_UPDATE_CALL(appUpdate)
+// uploads one texture, or every layer of a GL_TEXTURE_2D_ARRAY. Returns 0 if there is nothing to upload, the
+// driver can't sample the texture's format or the layers don't all have the same format and size.
+// The size of the uploaded texture is added to gpuMemoryBytes
+static u32 uploadTexture(TextureData* layers, u32 layerCount, GLenum target, u32 textureUnit, u64* gpuMemoryBytes)
 {
-	static f32 time = 0.0f;
-	static f32 cameraRotation = 0.0f;
-	
-	if (input->mouse.leftPressed)
-	{
-		f32 cameraDist = magnitude(memory->camera.pos - memory->camera.target);
-
-		f32 panFactor = MAX_PAN_SPEED*(cameraDist/MAX_ZOOM);
-		v2 diff = memory->lastMousePos - input->mouse.pos;
+	ASSERT(target == GL_TEXTURE_2D_ARRAY || layerCount == 1);
 
-		f32 xPanAmount = -diff.x*panFactor;
-		f32 yPanAmount = -diff.y*panFactor;
+	TextureData* texture = &layers[0];
+	if (layerCount == 0 || texture->levelCount == 0)
+		return 0;
 
-		v3f cameraDir = normalize(memory->camera.pos - memory->camera.target);
-		v3f cameraLeft = cross(V3f(0.0f, 1.0f, 0.0f), cameraDir);
-		v3f cameraBack = cross(cameraLeft, V3f(0.0f, -1.0f, 0.0f));
+	for (u32 layer = 1; layer < layerCount; ++layer)
+	{
+		TextureData* other = &layers[layer];
+		if (other->format != texture->format || other->levelCount != texture->levelCount ||
+			other->generateMipmaps != texture->generateMipmaps)
+			return 0;
 
-		v3f translateX = cameraLeft*xPanAmount;
-		v3f translateY = cameraBack*(-yPanAmount);
-		
-		memory->objectTransform.translate(translateX);
-		memory->objectTransform.translate(translateY);
+		for (u32 i = 0; i < texture->levelCount; ++i)
+		{
+			if (other->levels[i].width != texture->levels[i].width || other->levels[i].height != texture->levels[i].height)
+				return 0;
+		}
 	}
 
-	if (input->mouse.rightPressed)
+	GLenum internalFormat = 0;
+	switch (texture->format)
 	{
-	    s32 rotateDiff = input->mouse.pos.x - memory->lastMousePos.x;
+		case TEXTURE_FORMAT_RGBA8: internalFormat = GL_RGBA8; break;
+		case TEXTURE_FORMAT_R8: internalFormat = GL_R8; break;
+		case TEXTURE_FORMAT_BC4: internalFormat = GL_COMPRESSED_RED_RGTC1; break;
+		case TEXTURE_FORMAT_BC5: internalFormat = GL_COMPRESSED_RG_RGTC2; break;
 
-		Matrix4f rotationMatrix = getYRotationMatrix(-rotateDiff*0.005f);
-	    memory->camera.pos = rotationMatrix*memory->camera.pos;
+		case TEXTURE_FORMAT_BC1:
+		{
+			//NOTE(denis): S3TC was never made core because of patents, but every desktop driver has it
+			if (hasGLExtension("GL_EXT_texture_compression_s3tc"))
+				internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		} break;
 
-		cameraRotation += rotateDiff*0.005f;
-		if (cameraRotation > 2.0f*M_PI)
-			cameraRotation /= 2.0f*(f32)M_PI;
-	   	
-		s32 yDiff = memory->lastMousePos.y - input->mouse.pos.y;
-		f32 cameraDist = magnitude(memory->camera.pos - memory->camera.target);
+		default: break;
+	}
 
-		f32 zoomRatio = 0.01f;
-		if (cameraDist < MAX_ZOOM/5.0f)
-			zoomRatio = 0.006f;
-		
-		f32 zoomAmount = yDiff*zoomRatio;
+	if (internalFormat == 0)
+		return 0;
 
-		cameraDist -= zoomAmount;
+	bool compressed = texture->format != TEXTURE_FORMAT_RGBA8 && texture->format != TEXTURE_FORMAT_R8;
+	GLenum pixelFormat = texture->format == TEXTURE_FORMAT_R8 ? GL_RED : GL_RGBA;
 
-		if (cameraDist < MIN_ZOOM)
-			cameraDist = MIN_ZOOM;
-		else if (cameraDist > MAX_ZOOM)
-			cameraDist = MAX_ZOOM;
+	u32 textureID = 0;
+	glGenTextures(1, &textureID);
+	glActiveTexture(textureUnit);
+	glBindTexture(target, textureID);
 
-		v3f cameraDir = normalize(memory->camera.pos);
-		memory->camera.pos = cameraDir*cameraDist;
+	//NOTE(denis): rows are tightly packed, and with one byte per texel they aren't 4 byte aligned
+	if (texture->format == TEXTURE_FORMAT_R8)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-		memory->viewTransform = calculateViewMatrix(&memory->camera);
+	for (u32 i = 0; i < texture->levelCount; ++i)
+	{
+		TextureLevel* level = &texture->levels[i];
+		s32 width = (s32)level->width;
+		s32 height = (s32)level->height;
+
+		if (target == GL_TEXTURE_2D)
+		{
+			if (compressed)
+			{
+				glCompressedTexImage2D(target, i, internalFormat, width, height, 0, level->size, texture->levelData[i]);
+			}
+			else
+			{
+				glTexImage2D(target, i, internalFormat, width, height, 0, pixelFormat, GL_UNSIGNED_BYTE,
+							 texture->levelData[i]);
+			}
+		}
+		else
+		{
+			// allocate the whole level for every layer, then fill the layers in one at a time
+			if (compressed)
+			{
+				glCompressedTexImage3D(target, i, internalFormat, width, height, layerCount, 0, level->size*layerCount, 0);
+				for (u32 layer = 0; layer < layerCount; ++layer)
+				{
+					glCompressedTexSubImage3D(target, i, 0, 0, layer, width, height, 1, internalFormat, level->size,
+											  layers[layer].levelData[i]);
+				}
+			}
+			else
+			{
+				glTexImage3D(target, i, internalFormat, width, height, layerCount, 0, pixelFormat, GL_UNSIGNED_BYTE, 0);
+				for (u32 layer = 0; layer < layerCount; ++layer)
+				{
+					glTexSubImage3D(target, i, 0, 0, layer, width, height, 1, pixelFormat, GL_UNSIGNED_BYTE,
+									layers[layer].levelData[i]);
+				}
+			}
+		}
+
+		*gpuMemoryBytes += (u64)level->size*layerCount;
 	}
 
-	if (memory->oldController.actionPressed && !input->controller.actionPressed)
+	if (texture->format == TEXTURE_FORMAT_R8)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	u32 levelCount = texture->levelCount;
+	if (texture->generateMipmaps)
 	{
-		memory->windActive = (memory->windActive + 1) % 2;
-		glUniform1i(memory->shaderInfo.windActive, memory->windActive);
-		time = 0.0f;
+		glGenerateMipmap(target);
+		levelCount = getMipLevelCount(texture->levels[0].width, texture->levels[0].height);
+		//NOTE(denis): a full mip chain adds about a third on top of the base level
+		*gpuMemoryBytes += (u64)texture->levels[0].size*layerCount/3;
 	}
+	setTextureFiltering(target, levelCount);
 
-	//TODO(denis): these cause weird behaviour with the zooming function
-	if (input->controller.upPressed && memory->camera.pos.y < MAX_CAMERA_HEIGHT)
-	{
-		memory->camera.pos.y += CAMERA_HEIGHT_MOVEMENT;
+	return textureID;
+}
 
-		if (memory->camera.pos.y > MAX_CAMERA_HEIGHT)
-			memory->camera.pos.y = MAX_CAMERA_HEIGHT;
-		
-		memory->viewTransform = calculateViewMatrix(&memory->camera);
+static WORK_QUEUE_CALLBACK(readTextureJob)
+{
+	TextureLoad* load = (TextureLoad*)data;
+	readTexture(load->platform, &load->arena, load->imageFile, load->flags, &load->texture);
+}
+
+// the load has to stay where it is until finishTextureLoad
+static void addTextureLoadWork(Platform platform, MemoryArena* arena, TextureLoad* load, char* imageFile, u32 flags)
+{
+	*load = {};
+	load->platform = platform;
+	load->arena = pushSubArena(arena, TEXTURE_LOAD_ARENA_SIZE);
+	load->imageFile = imageFile;
+	load->flags = flags;
+	platform.addWork(platform.workQueue, readTextureJob, load);
+}
+
+// uploads what readTextureJob read for every layer and frees it
+static u32 finishTextureLoad(TextureLoad* loads, u32 layerCount, GLenum target, u32 textureUnit, u64* gpuMemoryBytes)
+{
+	//NOTE(denis): uploadTexture wants the layers next to each other
+	TextureData layers[MAX_TEXTURE_LAYERS];
+	ASSERT(layerCount <= MAX_TEXTURE_LAYERS);
+
+	bool fromContainer = false;
+	for (u32 layer = 0; layer < layerCount; ++layer)
+	{
+		layers[layer] = loads[layer].texture;
+		if (layers[layer].container.data)
+			fromContainer = true;
 	}
-	else if (input->controller.downPressed && memory->camera.pos.y > MIN_CAMERA_HEIGHT)
+
+	u32 textureID = uploadTexture(layers, layerCount, target, textureUnit, gpuMemoryBytes);
+	if (!textureID && fromContainer)
 	{
-		memory->camera.pos.y -= CAMERA_HEIGHT_MOVEMENT;
+		//NOTE(denis): either the format isn't supported or the layers' containers don't agree with each other,
+		// decoding every source image makes them all match
+		for (u32 layer = 0; layer < layerCount; ++layer)
+		{
+			TextureLoad* load = &loads[layer];
+			load->platform.debugOutput(load->imageFile);
+			load->platform.debugOutput(": the container can't be used, decoding the source image instead\n");
 
-		if (memory->camera.pos.y < MIN_CAMERA_HEIGHT)
-			memory->camera.pos.y = MIN_CAMERA_HEIGHT;
-		
-		memory->viewTransform = calculateViewMatrix(&memory->camera);
+			freeTextureData(load->platform, &load->texture);
+			decodeTexture(&load->arena, load->imageFile, load->flags, &load->texture);
+			layers[layer] = load->texture;
+		}
+		textureID = uploadTexture(layers, layerCount, target, textureUnit, gpuMemoryBytes);
 	}
+	ASSERT(textureID);
 
-	// these have to be done every frame because we never know when the user will resize the window
-	memory->projectionTransform = getProjectionTransform(&memory->camera);
-	updateShaderTransforms(memory->projectionTransform, memory->viewTransform, memory->objectTransform,
-						   &memory->camera, &memory->shaderInfo);
+	for (u32 layer = 0; layer < layerCount; ++layer)
+		freeTextureData(loads[layer].platform, &loads[layer].texture);
 
-	glUseProgram(memory->shaderInfo.groundProgram);
-	glBindVertexArray(memory->groundVAO);
-	drawGrassField(memory->objectTransform, memory->shaderInfo.groundObjectTransform, memory->shaderInfo.patchPos,
-				   6, GL_TRIANGLES);
+	return textureID;
+}
 
-	glUseProgram(memory->shaderInfo.grassProgram);
+static WORK_QUEUE_CALLBACK(readShadersJob)
+{
+	ShaderLoad* load = (ShaderLoad*)data;
 
-	time += 0.03f;
-	glUniform1f(memory->shaderInfo.time, time);
+	load->sourcesRead = readShaderSources(load->platform, load->shaderFiles, load->shaderSources);
+	if (load->sourcesRead && load->cacheFile)
+	{
+		load->cacheKey = getProgramCacheKey(load->driverHash, load->shaderSources);
+		load->platform.mapFile(load->cacheFile, &load->cache);
+	}
+}
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, memory->alphaTexture);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, memory->diffuseTexture);
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, memory->forceMap);
+// returns the program when the cached binary could be used, otherwise the sources are handed to the driver and
+// build is left to be finished (build->program is 0 when there is nothing to finish)
+static u32 startShaderLoad(ShaderLoad* load, ProgramBuild* build)
+{
+	u32 program = 0;
+	*build = {};
 
-	glBindVertexArray(memory->grassVAO);
+	if (load->sourcesRead)
+	{
+		if (load->cache.data)
+			program = createProgramFromCache(load->cache.data, load->cache.size, load->cacheKey);
+
+		if (!program)
+			startProgramBuild(build, load->shaderFiles, load->shaderSources, load->cacheFile, load->cacheKey);
+	}
+
+	// the driver has its own copies now
+	freeShaderSources(load->platform, load->shaderSources);
+	load->platform.unmapFile(&load->cache);
+
+	return program;
+}
+
+static WORK_QUEUE_CALLBACK(generateBladeChunkJob)
+{
+	BladeChunkGeneration* generation = (BladeChunkGeneration*)data;
+
+	RandomSeries random = createRandomSeries(generation->seed + generation->chunkIndex);
+	generateGrassPatch(generation->grassPlane, &random, generation->blades, getBladeChunkSize(generation->chunkIndex));
+}
+
+// data is an array of BladeChunkGenerations
+static WORK_RANGE_CALLBACK(generateBladeChunks)
+{
+	for (u32 i = first; i < onePastLast; ++i)
+		generateBladeChunkJob((BladeChunkGeneration*)data + i);
+}
+
+static void initBladeChunkGeneration(BladeChunkGeneration* generation, Memory* memory, u32 chunkIndex,
+									 GrassBlade* blades)
+{
+	generation->grassPlane = memory->grassPlane;
+	generation->seed = memory->bladeSeed;
+	generation->chunkIndex = chunkIndex;
+	generation->blades = blades;
+}
+
+static void addBladeChunkWork(Platform platform, BladeChunkGeneration* generation, Memory* memory, u32 chunkIndex,
+							  GrassBlade* blades, WorkCounter* counter = 0)
+{
+	initBladeChunkGeneration(generation, memory, chunkIndex, blades);
+	platform.addCountedWork(platform.workQueue, counter, generateBladeChunkJob, generation);
+}
+
+// generates and uploads as many chunks of the new blades as fit in this frame's budget. The jobs write straight
+// into the mapped stream buffer, and the GPU copies it over the old blades
+// regenerate starts a new field, which replaces any that is still streaming
+static void streamRegeneratedBlades(Platform platform, Memory* memory, bool regenerate)
+{
+	if (regenerate)
+	{
+		// taking the seed from rand() on this thread so replays regenerate the same blades
+		memory->bladeSeed = (u32)rand();
+		memory->nextBladeChunk = 0;
+	}
+
+	if (memory->nextBladeChunk >= BLADE_CHUNK_COUNT)
+		return;
+
+	u32 chunkBytes = BLADES_PER_CHUNK*sizeof(GrassBlade);
+	u32 numChunks = MIN(BLADE_UPLOAD_BUDGET/chunkBytes, BLADE_CHUNK_COUNT - memory->nextBladeChunk);
+
+	StreamBuffer* stream = &memory->bladeStream;
+	u8* staging = beginStreamRegion(stream);
+	if (!staging)
+		staging = PUSH_ARRAY(&memory->frameArena, numChunks*chunkBytes, u8);
+
+	BladeChunkGeneration* generations = PUSH_ARRAY(&memory->frameArena, numChunks, BladeChunkGeneration);
+	for (u32 i = 0; i < numChunks; ++i)
+	{
+		initBladeChunkGeneration(&generations[i], memory, memory->nextBladeChunk + i,
+								 (GrassBlade*)(staging + i*chunkBytes));
+	}
+	platform.parallelFor(platform.workQueue, numChunks, 1, generateBladeChunks, generations);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, memory->grassVertexBuffer);
+	if (stream->mapped)
+		glBindBuffer(GL_COPY_READ_BUFFER, stream->buffer);
+
+	for (u32 i = 0; i < numChunks; ++i)
+	{
+		u32 chunkIndex = memory->nextBladeChunk + i;
+		u32 destOffset = chunkIndex*chunkBytes;
+		u32 size = getBladeChunkSize(chunkIndex)*sizeof(GrassBlade);
+
+		if (stream->mapped)
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, getStreamRegionOffset(stream) + i*chunkBytes,
+								destOffset, size);
+		else
+			glBufferSubData(GL_COPY_WRITE_BUFFER, destOffset, size, staging + i*chunkBytes);
+	}
+
+	endStreamRegion(stream);
+	memory->nextBladeChunk += numChunks;
+}
+
+// builds the vertex grid for one patch into the bound VAO along with an index buffer for every level of detail.
+// The grid is followed by a copy of itself with y = -1, which the vertex shader turns into a skirt around the
+// patch's edges
+static void createTerrainMesh(MemoryArena* arena, TerrainMesh* terrain, u64* gpuMemoryBytes)
+{
+	TemporaryMemory meshMemory = beginTemporaryMemory(arena);
+
+	u32 rowLength = TERRAIN_GRID_RESOLUTION + 1;
+	u32 gridVertices = rowLength*rowLength;
+
+	v3f* vertices = PUSH_ARRAY(arena, gridVertices*2, v3f);
+	ASSERT(vertices);
+	for (u32 z = 0; z < rowLength; ++z)
+	{
+		for (u32 x = 0; x < rowLength; ++x)
+		{
+			f32 patchX = -0.5f + (f32)x/(f32)TERRAIN_GRID_RESOLUTION;
+			f32 patchZ = -0.5f + (f32)z/(f32)TERRAIN_GRID_RESOLUTION;
+
+			vertices[z*rowLength + x] = V3f(patchX, 0.0f, patchZ);
+			vertices[gridVertices + z*rowLength + x] = V3f(patchX, -1.0f, patchZ);
+		}
+	}
+
+	createVertexBuffer(vertices, gridVertices*2);
+	*gpuMemoryBytes += gridVertices*2*sizeof(v3f);
+
+	// the most indices any level needs, which is the full resolution grid and its skirt
+	u32 maxIndices = (TERRAIN_GRID_RESOLUTION*TERRAIN_GRID_RESOLUTION + 4*TERRAIN_GRID_RESOLUTION)*6;
+	u32* indices = PUSH_ARRAY(arena, maxIndices, u32);
+	ASSERT(indices);
+
+	for (u32 lod = 0; lod < TERRAIN_LOD_COUNT; ++lod)
+	{
+		u32 step = 1 << lod;
+		u32 indexCount = 0;
+
+		for (u32 z = 0; z < TERRAIN_GRID_RESOLUTION; z += step)
+		{
+			for (u32 x = 0; x < TERRAIN_GRID_RESOLUTION; x += step)
+			{
+				// same winding as the flat quad the ground used to be
+				u32 corners[4] = {
+					z*rowLength + x, z*rowLength + x + step, (z + step)*rowLength + x + step, (z + step)*rowLength + x
+				};
+
+				indices[indexCount++] = corners[2];
+				indices[indexCount++] = corners[1];
+				indices[indexCount++] = corners[0];
+
+				indices[indexCount++] = corners[2];
+				indices[indexCount++] = corners[0];
+				indices[indexCount++] = corners[3];
+			}
+		}
+
+		//NOTE(denis): a coarser neighbour skips some of our edge vertices, the skirt fills the crack that leaves
+		for (u32 i = 0; i < TERRAIN_GRID_RESOLUTION; i += step)
+		{
+			u32 last = TERRAIN_GRID_RESOLUTION;
+			u32 edges[4][2] = {
+				{i, i + step},
+				{last*rowLength + i, last*rowLength + i + step},
+				{i*rowLength, (i + step)*rowLength},
+				{i*rowLength + last, (i + step)*rowLength + last}
+			};
+
+			for (u32 edge = 0; edge < 4; ++edge)
+			{
+				u32 top0 = edges[edge][0];
+				u32 top1 = edges[edge][1];
+
+				indices[indexCount++] = top0;
+				indices[indexCount++] = top1;
+				indices[indexCount++] = gridVertices + top1;
+
+				indices[indexCount++] = top0;
+				indices[indexCount++] = gridVertices + top1;
+				indices[indexCount++] = gridVertices + top0;
+			}
+		}
+
+		ASSERT(indexCount <= maxIndices);
+		terrain->indexBuffers[lod] = createElementBuffer(indices, indexCount);
+		terrain->indexCounts[lod] = indexCount;
+		*gpuMemoryBytes += indexCount*sizeof(u32);
+	}
+
+	endTemporaryMemory(meshMemory);
+}
+
+// has to be redone whenever a program is rebuilt since the locations can change
+static void getUniformLocations(ShaderInfo* shaderInfo)
+{
+	//TODO(denis): these are now the exact same as the grass transforms, so there is probably a way to simplify this
+	shaderInfo->groundObjectTransform = glGetUniformLocation(shaderInfo->groundProgram, "object");
+	shaderInfo->groundViewTransform = glGetUniformLocation(shaderInfo->groundProgram, "view");
+	shaderInfo->groundProjectionTransform = glGetUniformLocation(shaderInfo->groundProgram, "projection");
+
+	shaderInfo->grassObjectTransform = glGetUniformLocation(shaderInfo->grassProgram, "objectTransform");
+	shaderInfo->grassViewTransform = glGetUniformLocation(shaderInfo->grassProgram, "viewTransform");
+	shaderInfo->grassProjectionTransform = glGetUniformLocation(shaderInfo->grassProgram, "projectionTransform");
+
+	shaderInfo->cameraPos = glGetUniformLocation(shaderInfo->grassProgram, "cameraPos");
+	shaderInfo->viewportHeight = glGetUniformLocation(shaderInfo->grassProgram, "viewportHeight");
+	shaderInfo->projectionScale = glGetUniformLocation(shaderInfo->grassProgram, "projectionScale");
+	shaderInfo->time = glGetUniformLocation(shaderInfo->grassProgram, "time");
+	shaderInfo->windActive = glGetUniformLocation(shaderInfo->grassProgram, "windActive");
+	shaderInfo->patchPos = glGetUniformLocation(shaderInfo->grassProgram, "patchPos");
+	shaderInfo->groundPatchPos = glGetUniformLocation(shaderInfo->groundProgram, "patchPos");
+}
+
+// the uniforms that are only set once, everything else is uploaded every frame
+static void setConstantUniforms(Memory* memory)
+{
+	u32 grassProgram = memory->shaderInfo.grassProgram;
+	glUseProgram(grassProgram);
+
+	u32 fieldOrigin = glGetUniformLocation(grassProgram, "fieldRect");
+	glUniform3fv(fieldOrigin, 2, (f32*)&memory->fieldRect[0]);
+
+	glUniform1i(glGetUniformLocation(grassProgram, "alphaToCoverage"), memory->msaaSamples > 1);
+
+	glUniform1i(glGetUniformLocation(grassProgram, "alphaTexture"), 0);
+	glUniform1i(glGetUniformLocation(grassProgram, "diffuseTexture"), 1);
+	glUniform1i(glGetUniformLocation(grassProgram, "forceMap"), 2);
+	glUniform1i(glGetUniformLocation(grassProgram, "heightMap"), 3);
+	glUniform1f(glGetUniformLocation(grassProgram, "heightScale"), TERRAIN_HEIGHT_SCALE);
+	glUniform1f(glGetUniformLocation(grassProgram, "pixelsPerSegment"), GRASS_PIXELS_PER_SEGMENT);
+	glUniform1f(glGetUniformLocation(grassProgram, "minFacingPixels"), GRASS_MIN_FACING_PIXELS);
+	glUniform1i(glGetUniformLocation(grassProgram, "vegetationMap"), 4);
+
+	s32 alphaLayers[BLADE_SPECIES_COUNT];
+	s32 diffuseLayers[BLADE_SPECIES_COUNT];
+	f32 widthScales[BLADE_SPECIES_COUNT];
+	f32 heightScales[BLADE_SPECIES_COUNT];
+	f32 bendingScales[BLADE_SPECIES_COUNT];
+	v3f rootColours[BLADE_SPECIES_COUNT];
+	v3f tipColours[BLADE_SPECIES_COUNT];
+	for (u32 i = 0; i < BLADE_SPECIES_COUNT; ++i)
+	{
+		BladeSpecies* species = &_bladeSpecies[i];
+		ASSERT(species->alphaLayer < (s32)ARRAY_COUNT(_alphaTextureFiles));
+		ASSERT(species->diffuseLayer < (s32)ARRAY_COUNT(_diffuseTextureFiles));
+
+		alphaLayers[i] = species->alphaLayer;
+		diffuseLayers[i] = species->diffuseLayer;
+		widthScales[i] = species->widthScale;
+		heightScales[i] = species->heightScale;
+		bendingScales[i] = species->bendingScale;
+		rootColours[i] = species->rootColour;
+		tipColours[i] = species->tipColour;
+	}
+
+	glUniform1iv(glGetUniformLocation(grassProgram, "speciesAlphaLayer"), BLADE_SPECIES_COUNT, alphaLayers);
+	glUniform1iv(glGetUniformLocation(grassProgram, "speciesDiffuseLayer"), BLADE_SPECIES_COUNT, diffuseLayers);
+	glUniform1fv(glGetUniformLocation(grassProgram, "speciesWidthScale"), BLADE_SPECIES_COUNT, widthScales);
+	glUniform1fv(glGetUniformLocation(grassProgram, "speciesHeightScale"), BLADE_SPECIES_COUNT, heightScales);
+	glUniform1fv(glGetUniformLocation(grassProgram, "speciesBendingScale"), BLADE_SPECIES_COUNT, bendingScales);
+	glUniform3fv(glGetUniformLocation(grassProgram, "speciesRootColour"), BLADE_SPECIES_COUNT, (f32*)rootColours);
+	glUniform3fv(glGetUniformLocation(grassProgram, "speciesTipColour"), BLADE_SPECIES_COUNT, (f32*)tipColours);
+
+	u32 groundProgram = memory->shaderInfo.groundProgram;
+	glUseProgram(groundProgram);
+
+	glUniform3fv(glGetUniformLocation(groundProgram, "fieldRect"), 2, (f32*)&memory->fieldRect[0]);
+	glUniform1i(glGetUniformLocation(groundProgram, "heightMap"), 3);
+	glUniform1f(glGetUniformLocation(groundProgram, "heightScale"), TERRAIN_HEIGHT_SCALE);
+	glUniform1f(glGetUniformLocation(groundProgram, "skirtDepth"), TERRAIN_SKIRT_DEPTH);
+}
+
+// returns false if the program is still being built from an earlier change, or if the sources couldn't be read
+// (usually an editor that is still saving or has the file locked), so it has to be tried again later
+static bool startProgramReload(Platform platform, ProgramBuild* build, char* shaderFiles[SHADER_STAGE_COUNT],
+							   char* cacheFile)
+{
+	if (build->program)
+		return false;
+
+	MappedFile shaderSources[SHADER_STAGE_COUNT];
+	bool sourcesRead = readShaderSources(platform, shaderFiles, shaderSources);
+	if (sourcesRead)
+	{
+		if (!programBinariesSupported())
+			cacheFile = 0;
+
+		u64 cacheKey = cacheFile ? getProgramCacheKey(getDriverHash(), shaderSources) : 0;
+		startProgramBuild(build, shaderFiles, shaderSources, cacheFile, cacheKey);
+	}
+	freeShaderSources(platform, shaderSources);
+
+	return sourcesRead;
+}
+
+// swaps the rebuilt program in once the driver is done with it, returns true if the program changed
+static bool finishProgramReload(Platform platform, MemoryArena* arena, ProgramBuild* build, u32* program)
+{
+	if (!build->program || !programBuildReady(build))
+		return false;
+
+	u32 newProgram = finishProgramBuild(platform, arena, build);
+	if (!newProgram)
+	{
+		platform.debugOutput("Keeping the previous shader program\n");
+		return false;
+	}
+
+	glDeleteProgram(*program);
+	*program = newProgram;
+
+	return true;
+}
+
+static void reloadChangedShaders(Platform platform, Memory* memory, f32 frameDelta)
+{
+	if (platform.directoryChanged(memory->shaderWatch))
+	{
+		memory->shaderReloadDelay = SHADER_RELOAD_DELAY;
+		memory->groundReloadPending = true;
+		memory->grassReloadPending = true;
+	}
+
+	if (memory->shaderReloadDelay > 0.0f)
+	{
+		memory->shaderReloadDelay -= frameDelta;
+		if (memory->shaderReloadDelay <= 0.0f)
+		{
+			if (memory->groundReloadPending)
+			{
+				memory->groundReloadPending = !startProgramReload(platform, &memory->groundProgramBuild,
+																  _groundShaderFiles, GROUND_PROGRAM_CACHE);
+			}
+			if (memory->grassReloadPending)
+			{
+				memory->grassReloadPending = !startProgramReload(platform, &memory->grassProgramBuild,
+																 _grassShaderFiles, GRASS_PROGRAM_CACHE);
+			}
+
+			// an older build is still in flight or a file is still being written, so only the programs that
+			// couldn't be started are tried again rather than losing this change
+			if (memory->groundReloadPending || memory->grassReloadPending)
+				memory->shaderReloadDelay = SHADER_RELOAD_DELAY;
+		}
+	}
+
+	ShaderInfo* shaderInfo = &memory->shaderInfo;
+	bool groundChanged = finishProgramReload(platform, &memory->frameArena, &memory->groundProgramBuild,
+											 &shaderInfo->groundProgram);
+	bool grassChanged = finishProgramReload(platform, &memory->frameArena, &memory->grassProgramBuild,
+											&shaderInfo->grassProgram);
+
+	if (groundChanged || grassChanged)
+	{
+		getUniformLocations(shaderInfo);
+		setConstantUniforms(memory);
+	}
+}
+
+static void initArenas(Memory* memory)
+{
+	//NOTE(denis): the Memory struct is at the start of the block, the arenas split up the rest of it
+	u8* arenaMemory = (u8*)memory + sizeof(Memory);
+	u64 arenaMemorySize = APP_MEMORY_SIZE - sizeof(Memory);
+	ASSERT(arenaMemorySize > PERMANENT_ARENA_SIZE);
+	initArena(&memory->permanentArena, arenaMemory, PERMANENT_ARENA_SIZE);
+	initArena(&memory->frameArena, arenaMemory + PERMANENT_ARENA_SIZE, arenaMemorySize - PERMANENT_ARENA_SIZE);
+}
+
+// the plane the blades are generated on, the seed they're generated from and the field the patches make up
+static void initField(Memory* memory)
+{
+	memory->grassPlane[0] = V3f(-0.5f, 0.0f, -0.5f);
+	memory->grassPlane[1] = V3f(0.5f, 0.0f, -0.5f);
+	memory->grassPlane[2] = V3f(0.5f, 0.0f, 0.5f);
+	memory->grassPlane[3] = V3f(-0.5f, 0.0f, 0.5f);
+
+	// taking the seed from rand() here so that srand() on this thread still decides the blades
+	memory->bladeSeed = (u32)rand();
 
-	drawGrassField(memory->objectTransform, memory->shaderInfo.grassObjectTransform, memory->shaderInfo.patchPos,
-				   memory->numBladeVertices, GL_PATCHES);
+	//TODO(denis): assumes the 9 square system is how the patches are organized
+	memory->fieldRect[0] = memory->grassPlane[0] - V3f(1.0f, 0.0f, 1.0f);
+	memory->fieldRect[1] = memory->grassPlane[2] + V3f(1.0f, 0.0f, 1.0f);
+}
+
+static void initSimulationState(SimulationState* state)
+{
+	state->objectTransform = M4f();
+	state->time = 0.0f;
+
+	Camera* camera = &state->camera;
+	camera->fov= CAMERA_FOV;
+	camera->pos = V3f(0.0f, 3.0f, 5.0f);
+	camera->target = V3f(0.0f, 0.0f, 0.0f);
+	camera->upDir = V3f(0.0f, 1.0f, 0.0f);
+	camera->near = NEAR_PLANE;
+	camera->far = FAR_PLANE;
+}
+
+// the same texels the GPU is given for a data texture, without uploading them
+static ReferenceImage readReferenceImage(Platform platform, MemoryArena* arena, char* imageFile)
+{
+	TextureData texture;
+	readTexture(platform, arena, imageFile, 0, &texture);
+	ReferenceImage result = copyReferenceImage(arena, &texture);
+	freeTextureData(platform, &texture);
+
+	return result;
+}
+
+APP_INIT_CALL(appInit)
+{
+	initArenas(memory);
+
+	// everything loaded during init is only needed until it has been handed to GL
+	MemoryArena* loadArena = &memory->frameArena;
+	TemporaryMemory loadMemory = beginTemporaryMemory(loadArena);
+
+	enableParallelShaderCompile();
+	memory->shaderWatch = platform.watchDirectory(SHADER_DIRECTORY);
+	memory->shaderReloadDelay = 0.0f;
+	memory->groundReloadPending = false;
+	memory->grassReloadPending = false;
+
+	// everything that doesn't need GL is started on the worker threads first, and only the uploads are done here
+	// once it's all finished
+	u64 driverHash = getDriverHash();
+	bool cachePrograms = programBinariesSupported();
+
+	ShaderLoad groundShaderLoad = {};
+	groundShaderLoad.platform = platform;
+	groundShaderLoad.shaderFiles = _groundShaderFiles;
+	if (cachePrograms)
+		groundShaderLoad.cacheFile = GROUND_PROGRAM_CACHE;
+	groundShaderLoad.driverHash = driverHash;
+
+	//NOTE(denis): copied before the ground job is started, since the job writes into its load
+	ShaderLoad grassShaderLoad = groundShaderLoad;
+	grassShaderLoad.shaderFiles = _grassShaderFiles;
+	if (cachePrograms)
+		grassShaderLoad.cacheFile = GRASS_PROGRAM_CACHE;
+
+	platform.addWork(platform.workQueue, readShadersJob, &groundShaderLoad);
+	platform.addWork(platform.workQueue, readShadersJob, &grassShaderLoad);
+
+	initField(memory);
+	memory->nextBladeChunk = BLADE_CHUNK_COUNT;
+
+	GrassBlade* blades = PUSH_ARRAY(loadArena, NUM_BLADES_TO_GENERATE, GrassBlade);
+	BladeChunkGeneration* bladeChunks = PUSH_ARRAY(loadArena, BLADE_CHUNK_COUNT, BladeChunkGeneration);
+	ASSERT(blades && bladeChunks);
+	for (u32 i = 0; i < BLADE_CHUNK_COUNT; ++i)
+		addBladeChunkWork(platform, &bladeChunks[i], memory, i, blades + i*BLADES_PER_CHUNK);
+
+	TextureLoad alphaTextureLoads[ARRAY_COUNT(_alphaTextureFiles)];
+	for (u32 i = 0; i < ARRAY_COUNT(_alphaTextureFiles); ++i)
+	{
+		addTextureLoadWork(platform, loadArena, &alphaTextureLoads[i], _alphaTextureFiles[i],
+						   TEXTURE_MIPMAPPED|TEXTURE_COVERAGE_MASK);
+	}
+
+	TextureLoad diffuseTextureLoads[ARRAY_COUNT(_diffuseTextureFiles)];
+	for (u32 i = 0; i < ARRAY_COUNT(_diffuseTextureFiles); ++i)
+		addTextureLoadWork(platform, loadArena, &diffuseTextureLoads[i], _diffuseTextureFiles[i], TEXTURE_MIPMAPPED);
+
+	//NOTE(denis): the force map is sampled as data (one texel per blade position), so filtering it across mips
+	// would just smear the forces. The same goes for the vegetation map, a blade between two species would get
+	// whichever one is in between them
+	TextureLoad forceMapLoad;
+	addTextureLoadWork(platform, loadArena, &forceMapLoad, forceMapFile, 0);
+
+	TextureLoad heightMapLoad;
+	addTextureLoadWork(platform, loadArena, &heightMapLoad, "terrain_heightmap.png", 0);
+
+	TextureLoad vegetationMapLoad;
+	addTextureLoadWork(platform, loadArena, &vegetationMapLoad, "vegetation_map.png", 0);
+
+	glGenVertexArrays(1, &memory->groundVAO);
+	glBindVertexArray(memory->groundVAO);
+
+	createTerrainMesh(loadArena, &memory->terrain, &memory->gpuMemoryBytes);
 	
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(v3f), 0);
+	glEnableVertexAttribArray(0);
+
+	SimulationState* state = &memory->currentState;
+	initSimulationState(state);
+	Camera* camera = &state->camera;
+
+	memory->previousState = memory->currentState;
+	memory->timeAccumulator = 0.0f;
+	memory->simulationCounter = {};
+	memory->simulatedPacket = 0;
+	memory->framePacketReady = false;
+
+	memory->viewTransform = calculateViewMatrix(camera);
+	memory->projectionTransform = getProjectionTransform(camera);
+
+	memory->objectTransform = state->objectTransform;
+
+	glEnable(GL_DEPTH_TEST);
+
+	s32 maxSamples = 0;
+	glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+	memory->msaaSamples = MIN(MSAA_SAMPLES, (u32)maxSamples);
+	// created on the first frame once we know how big the target is
+	memory->msaaFramebuffer = {};
+
+	memory->oldController = {};
+	memory->lastMousePos = V2(-1, -1);
+	memory->windActive = 0;
+	memory->cameraRotation = 0.0f;
+
+	platform.completeAllWork(platform.workQueue);
+
+	// both programs are submitted before waiting on either so the driver can compile them side by side
+	ShaderInfo* shaderInfo = &memory->shaderInfo;
+	ProgramBuild groundBuild, grassBuild;
+	shaderInfo->groundProgram = startShaderLoad(&groundShaderLoad, &groundBuild);
+	shaderInfo->grassProgram = startShaderLoad(&grassShaderLoad, &grassBuild);
+
+	if (groundBuild.program)
+		shaderInfo->groundProgram = finishProgramBuild(platform, loadArena, &groundBuild);
+	if (grassBuild.program)
+		shaderInfo->grassProgram = finishProgramBuild(platform, loadArena, &grassBuild);
+
+	ASSERT(shaderInfo->groundProgram);
+	ASSERT(shaderInfo->grassProgram);
+
+	getUniformLocations(shaderInfo);
+
+	// each quad is a patch
+	glPatchParameteri(GL_PATCH_VERTICES, 4);
+	
+	glGenVertexArrays(1, &memory->grassVAO);
+	glBindVertexArray(memory->grassVAO);
+
+	memory->numBladeVertices = NUM_BLADES_TO_GENERATE*4;
+
+	u32 componentsPerBlade = sizeof(GrassBlade) / sizeof(v4f);
+	memory->grassVertexBuffer = createVertexBuffer((v4f*)blades, NUM_BLADES_TO_GENERATE * componentsPerBlade);
+	memory->gpuMemoryBytes += NUM_BLADES_TO_GENERATE*sizeof(GrassBlade);
+
+	ASSERT(BLADE_UPLOAD_BUDGET >= BLADES_PER_CHUNK*sizeof(GrassBlade));
+	if (createStreamBuffer(&memory->bladeStream, BLADE_UPLOAD_BUDGET))
+		memory->gpuMemoryBytes += BLADE_UPLOAD_BUDGET*STREAM_BUFFER_REGION_COUNT;
+
+	u32 vertexStride = sizeof(v4f)*4;
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, vertexStride, 0);
+	glEnableVertexAttribArray(0);
+
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, vertexStride, (void*)sizeof(v4f));
+	glEnableVertexAttribArray(1);
+
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, vertexStride, (void*)(sizeof(v4f)*2));
+	glEnableVertexAttribArray(2);
+
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, vertexStride, (void*)(sizeof(v4f)*3));
+	glEnableVertexAttribArray(3);
+
+	// setting up textures
+	memory->forceMapImage = copyReferenceImage(&memory->permanentArena, &forceMapLoad.texture);
+	memory->heightMapImage = copyReferenceImage(&memory->permanentArena, &heightMapLoad.texture);
+	memory->vegetationMapImage = copyReferenceImage(&memory->permanentArena, &vegetationMapLoad.texture);
+	memory->alphaTexture = finishTextureLoad(alphaTextureLoads, ARRAY_COUNT(alphaTextureLoads), GL_TEXTURE_2D_ARRAY,
+											 GL_TEXTURE0, &memory->gpuMemoryBytes);
+	memory->diffuseTexture = finishTextureLoad(diffuseTextureLoads, ARRAY_COUNT(diffuseTextureLoads),
+											   GL_TEXTURE_2D_ARRAY, GL_TEXTURE1, &memory->gpuMemoryBytes);
+	memory->forceMap = finishTextureLoad(&forceMapLoad, 1, GL_TEXTURE_2D, GL_TEXTURE2, &memory->gpuMemoryBytes);
+	memory->heightMap = finishTextureLoad(&heightMapLoad, 1, GL_TEXTURE_2D, GL_TEXTURE3, &memory->gpuMemoryBytes);
+	memory->vegetationMap = finishTextureLoad(&vegetationMapLoad, 1, GL_TEXTURE_2D, GL_TEXTURE4,
+											  &memory->gpuMemoryBytes);
+
+	setConstantUniforms(memory);
+
+	endTemporaryMemory(loadMemory);
+}
+
+APP_SHUTDOWN_CALL(appShutdown)
+{
+	//NOTE(denis): the benchmark runs appInit once per scenario, so anything not in the memory block has to be
+	// handed back here or it piles up
+	platform.unwatchDirectory(memory->shaderWatch);
+	memory->shaderWatch = 0;
+}
+
+// advances the simulation by one SIMULATION_TIMESTEP, anything the GL thread has to do is requested in the packet
+static void simulate(Memory* memory, Input* input, FramePacket* packet)
+{
+	SimulationState* state = &memory->currentState;
+	Camera* camera = &state->camera;
+
+	if (input->mouse.leftPressed)
+	{
+		f32 cameraDist = magnitude(camera->pos - camera->target);
+
+		f32 panFactor = MAX_PAN_SPEED*(cameraDist/MAX_ZOOM);
+		v2 diff = memory->lastMousePos - input->mouse.pos;
+
+		f32 xPanAmount = -diff.x*panFactor;
+		f32 yPanAmount = -diff.y*panFactor;
+
+		v3f cameraDir = normalize(camera->pos - camera->target);
+		v3f cameraLeft = cross(V3f(0.0f, 1.0f, 0.0f), cameraDir);
+		v3f cameraBack = cross(cameraLeft, V3f(0.0f, -1.0f, 0.0f));
+
+		v3f translateX = cameraLeft*xPanAmount;
+		v3f translateY = cameraBack*(-yPanAmount);
+		
+		state->objectTransform.translate(translateX);
+		state->objectTransform.translate(translateY);
+	}
+
+	if (input->mouse.rightPressed)
+	{
+	    s32 rotateDiff = input->mouse.pos.x - memory->lastMousePos.x;
+
+		Matrix4f rotationMatrix = getYRotationMatrix(-rotateDiff*0.005f);
+	    camera->pos = rotationMatrix*camera->pos;
+
+		memory->cameraRotation += rotateDiff*0.005f;
+		if (memory->cameraRotation > 2.0f*M_PI)
+			memory->cameraRotation /= 2.0f*(f32)M_PI;
+	   	
+		s32 yDiff = memory->lastMousePos.y - input->mouse.pos.y;
+		f32 cameraDist = magnitude(camera->pos - camera->target);
+
+		f32 zoomRatio = 0.01f;
+		if (cameraDist < MAX_ZOOM/5.0f)
+			zoomRatio = 0.006f;
+		
+		f32 zoomAmount = yDiff*zoomRatio;
+
+		cameraDist -= zoomAmount;
+
+		if (cameraDist < MIN_ZOOM)
+			cameraDist = MIN_ZOOM;
+		else if (cameraDist > MAX_ZOOM)
+			cameraDist = MAX_ZOOM;
+
+		v3f cameraDir = normalize(camera->pos);
+		camera->pos = cameraDir*cameraDist;
+	}
+
+	if (input->cameraTurn != 0.0f)
+	{
+		camera->pos = getYRotationMatrix(-input->cameraTurn)*camera->pos;
+		memory->cameraRotation += input->cameraTurn;
+	}
+
+	if (memory->oldController.actionPressed && !input->controller.actionPressed)
+	{
+		memory->windActive = (memory->windActive + 1) % 2;
+
+		// restarting the wind shouldn't be interpolated from the old time
+		state->time = 0.0f;
+		memory->previousState.time = 0.0f;
+	}
+
+	// a whole new field of blades, it's streamed in over the next few frames
+	if (memory->oldController.rightPressed && !input->controller.rightPressed)
+		packet->regenerateBlades = true;
+
+	if (memory->oldController.softwareRenderPressed && !input->controller.softwareRenderPressed)
+		packet->softwareRenderRequested = true;
+
+	if (memory->oldController.posterPressed && !input->controller.posterPressed)
+		packet->posterRequested = true;
+
+	//TODO(denis): these cause weird behaviour with the zooming function
+	if (input->controller.upPressed && camera->pos.y < MAX_CAMERA_HEIGHT)
+	{
+		camera->pos.y += CAMERA_HEIGHT_MOVEMENT;
+
+		if (camera->pos.y > MAX_CAMERA_HEIGHT)
+			camera->pos.y = MAX_CAMERA_HEIGHT;
+	}
+	else if (input->controller.downPressed && camera->pos.y > MIN_CAMERA_HEIGHT)
+	{
+		camera->pos.y -= CAMERA_HEIGHT_MOVEMENT;
+
+		if (camera->pos.y < MIN_CAMERA_HEIGHT)
+			camera->pos.y = MIN_CAMERA_HEIGHT;
+	}
+
+	state->time += WIND_TIME_PER_STEP;
+
 	memory->oldController = input->controller;
 	memory->lastMousePos = input->mouse.pos;
 }
+
+// t is how far we are between the previous and current simulation states, in [0, 1)
+static SimulationState interpolateStates(SimulationState* previous, SimulationState* current, f32 t)
+{
+	SimulationState result = *current;
+
+	result.camera.pos = previous->camera.pos*(1.0f - t) + current->camera.pos*t;
+	result.camera.target = previous->camera.target*(1.0f - t) + current->camera.target*t;
+
+	v3f previousTranslation = previous->objectTransform.getTranslation();
+	v3f currentTranslation = current->objectTransform.getTranslation();
+	result.objectTransform.setTranslation(previousTranslation*(1.0f - t) + currentTranslation*t);
+
+	result.time = previous->time*(1.0f - t) + current->time*t;
+
+	return result;
+}
+
+// runs the fixed timesteps that frameDelta covers and fills the job's packet with what the GL thread needs to draw
+// the result. It runs on a worker thread while the previous packet is drawn, so it must not touch GL
+static WORK_QUEUE_CALLBACK(simulateFrameJob)
+{
+	SimulationJob* job = (SimulationJob*)data;
+	Memory* memory = job->memory;
+	FramePacket* packet = job->packet;
+
+	packet->regenerateBlades = false;
+	packet->softwareRenderRequested = false;
+	packet->posterRequested = false;
+
+	// after a long stall we would rather slow down than try to catch up on every step we missed
+	memory->timeAccumulator += MIN(job->frameDelta, MAX_FRAME_DELTA);
+
+	while (memory->timeAccumulator >= SIMULATION_TIMESTEP)
+	{
+		memory->previousState = memory->currentState;
+		simulate(memory, &job->input, packet);
+		memory->timeAccumulator -= SIMULATION_TIMESTEP;
+	}
+
+	f32 t = memory->timeAccumulator / SIMULATION_TIMESTEP;
+	packet->state = interpolateStates(&memory->previousState, &memory->currentState, t);
+	packet->windActive = memory->windActive;
+
+	// the projection is worked out every frame because we never know when the user will resize the window
+	Camera* camera = &packet->state.camera;
+	packet->viewTransform = calculateViewMatrix(camera);
+	packet->projectionTransform = getProjectionTransform(camera, (u32)job->viewportWidth, (u32)job->viewportHeight);
+
+	packet->visiblePatchCount = cullField(packet->state.objectTransform,
+										  packet->projectionTransform*packet->viewTransform, camera->pos,
+										  packet->visiblePatches);
+}
+
+// binds the multisampled framebuffer (remaking it if the target was resized) and clears it the same way the
+// platform cleared the target, returns false if we are drawing straight into the target instead
+static bool beginMultisampledFrame(Memory* memory, u32 width, u32 height)
+{
+	if (memory->msaaSamples <= 1)
+		return false;
+
+	Framebuffer* framebuffer = &memory->msaaFramebuffer;
+	if (framebuffer->width != width || framebuffer->height != height || !framebuffer->id)
+	{
+		deleteFramebuffer(framebuffer);
+		*framebuffer = createFramebuffer(width, height, memory->msaaSamples);
+
+		if (!framebuffer->id)
+		{
+			// we won't get a different answer next frame, so give up on MSAA for good
+			memory->msaaSamples = 0;
+			glUseProgram(memory->shaderInfo.grassProgram);
+			glUniform1i(glGetUniformLocation(memory->shaderInfo.grassProgram, "alphaToCoverage"), 0);
+			return false;
+		}
+	}
+
+	f32 clearColour[4];
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColour);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer->id);
+	glClearColor(clearColour[0], clearColour[1], clearColour[2], clearColour[3]);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	return true;
+}
+
+// averages the samples down into the target framebuffer and leaves the target bound
+static void resolveMultisampledFrame(Memory* memory, u32 targetFramebuffer)
+{
+	Framebuffer* framebuffer = &memory->msaaFramebuffer;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer->id);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFramebuffer);
+	glBlitFramebuffer(0, 0, framebuffer->width, framebuffer->height, 0, 0, framebuffer->width, framebuffer->height,
+					  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+}
+
+// draws the packet's state with the given projection. patches is the part of the field that's visible with it, which
+// is the packet's own list unless the projection isn't the packet's
+static void render(Memory* memory, FramePacket* packet, Matrix4f projection, PatchDraw* patches, u32 patchCount,
+				   FrameStats* frameStats)
+{
+	SimulationState* state = &packet->state;
+
+	// the platform decides where the frame goes (the window or an offscreen target), we only draw into our own
+	// multisampled framebuffer in between
+	s32 targetFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFramebuffer);
+	s32 viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	bool multisampled = beginMultisampledFrame(memory, viewport[2], viewport[3]);
+
+	memory->objectTransform = state->objectTransform;
+	memory->viewTransform = packet->viewTransform;
+
+	memory->projectionTransform = projection;
+	updateShaderTransforms(memory->projectionTransform, memory->viewTransform, memory->objectTransform,
+						   &state->camera, viewport[3], &memory->shaderInfo);
+
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_2D, memory->heightMap);
+
+	glUseProgram(memory->shaderInfo.groundProgram);
+	glBindVertexArray(memory->groundVAO);
+
+	u32 groundPatchesDrawn = drawGrassField(patches, patchCount, memory->shaderInfo.groundObjectTransform,
+											memory->shaderInfo.groundPatchPos, 0, GL_TRIANGLES, &memory->terrain);
+
+	glUseProgram(memory->shaderInfo.grassProgram);
+
+	glUniform1i(memory->shaderInfo.windActive, packet->windActive);
+	glUniform1f(memory->shaderInfo.time, state->time);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, memory->alphaTexture);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, memory->diffuseTexture);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, memory->forceMap);
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_2D, memory->vegetationMap);
+
+	glBindVertexArray(memory->grassVAO);
+
+	if (multisampled)
+		glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+
+	u32 grassPatchesDrawn = drawGrassField(patches, patchCount, memory->shaderInfo.grassObjectTransform,
+										   memory->shaderInfo.patchPos, memory->numBladeVertices, GL_PATCHES);
+
+	if (multisampled)
+	{
+		glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+		resolveMultisampledFrame(memory, targetFramebuffer);
+	}
+
+	frameStats->bladesSubmitted = grassPatchesDrawn*(memory->numBladeVertices/4);
+	frameStats->drawCalls = groundPatchesDrawn + grassPatchesDrawn;
+	frameStats->gpuMemoryBytes = memory->gpuMemoryBytes;
+	frameStats->arenaPeakBytes = memory->permanentArena.peakUsed + memory->frameArena.peakUsed;
+	if (multisampled)
+	{
+		// RGBA8 colour and 24 bit depth (which is padded to 32 bits) for every sample
+		Framebuffer* framebuffer = &memory->msaaFramebuffer;
+		frameStats->gpuMemoryBytes += (u64)framebuffer->width*framebuffer->height*framebuffer->samples*8;
+	}
+}
+
+// a GrassReferenceInput for drawing the patch in column col and row row of the field with the packet's transforms,
+// into a viewport viewportHeight pixels high
+static void getGrassReferenceInput(Memory* memory, FramePacket* packet, s32 col, s32 row, s32 viewportHeight,
+								   GrassReferenceInput* input)
+{
+	SimulationState* state = &packet->state;
+
+	*input = {};
+	input->objectTransform = getPatchTransform(state->objectTransform, col, row, &input->patchPos);
+	input->viewTransform = packet->viewTransform;
+	input->projectionTransform = packet->projectionTransform;
+	input->fieldRect[0] = memory->fieldRect[0];
+	input->fieldRect[1] = memory->fieldRect[1];
+	input->cameraPos = state->camera.pos;
+	input->time = state->time;
+	input->windActive = packet->windActive == 1;
+	input->viewportHeight = (f32)viewportHeight;
+	input->projectionScale = packet->projectionTransform[1][1];
+	input->pixelsPerSegment = GRASS_PIXELS_PER_SEGMENT;
+	input->minFacingPixels = GRASS_MIN_FACING_PIXELS;
+	input->forceMap = memory->forceMapImage;
+	input->heightMap = memory->heightMapImage;
+	input->vegetationMap = memory->vegetationMapImage;
+	input->heightScale = TERRAIN_HEIGHT_SCALE;
+	input->species = _bladeSpecies;
+}
+
+// decodes the source image so the CPU gets every texel, the GPU's containers are compressed
+static ReferenceImage loadReferenceImage(Platform platform, MemoryArena* arena, char* imageFile, u32 flags)
+{
+	ReferenceImage result = {};
+
+	TextureData texture;
+	if (decodeTexture(arena, imageFile, flags, &texture))
+		result = copyReferenceImage(arena, &texture);
+	freeTextureData(platform, &texture);
+
+	return result;
+}
+
+// draws the packet's grass on the CPU and writes the colour out to colourFile, and the depth to depthFile if there
+// is one. The ground isn't drawn, the blades are on clearColour.
+//NOTE(denis): doesn't touch GL, everything comes from the packet and the CPU copies of the data textures
+static bool renderSoftwareFrame(Platform platform, Memory* memory, FramePacket* packet, s32 width, s32 height,
+								v4f clearColour, char* colourFile, char* depthFile)
+{
+	MemoryArena* arena = &memory->frameArena;
+	TemporaryMemory renderMemory = beginTemporaryMemory(arena);
+
+	SoftwareTarget target = {};
+	target.width = width;
+	target.height = height;
+	target.colour = TRY_PUSH_ARRAY(arena, (u64)width*height*4, u8);
+	target.depth = TRY_PUSH_ARRAY(arena, (u64)width*height, f32);
+
+	// the blades come from the same seed as the ones on the GPU, so they don't have to be read back
+	GrassBlade* blades = TRY_PUSH_ARRAY(arena, NUM_BLADES_TO_GENERATE, GrassBlade);
+	BladeChunkGeneration* bladeChunks = TRY_PUSH_ARRAY(arena, BLADE_CHUNK_COUNT, BladeChunkGeneration);
+	if (!target.colour || !target.depth || !blades || !bladeChunks)
+	{
+		platform.debugOutput("Not enough memory for a software render\n");
+		endTemporaryMemory(renderMemory);
+		return false;
+	}
+
+	// the blades are generated while the textures are decoded here
+	WorkCounter bladesGenerated = {};
+	for (u32 i = 0; i < BLADE_CHUNK_COUNT; ++i)
+		addBladeChunkWork(platform, &bladeChunks[i], memory, i, blades + i*BLADES_PER_CHUNK, &bladesGenerated);
+
+	RasterTextures textures = {};
+	textures.species = _bladeSpecies;
+	for (u32 i = 0; i < ARRAY_COUNT(_alphaTextureFiles); ++i)
+		textures.alphaLayers[i] = loadReferenceImage(platform, arena, _alphaTextureFiles[i], TEXTURE_COVERAGE_MASK);
+	for (u32 i = 0; i < ARRAY_COUNT(_diffuseTextureFiles); ++i)
+		textures.diffuseLayers[i] = loadReferenceImage(platform, arena, _diffuseTextureFiles[i], 0);
+
+	platform.waitForCounter(platform.workQueue, &bladesGenerated);
+
+	clearSoftwareTarget(&target, clearColour);
+
+	bool succeeded = true;
+	for (s32 row = -1; row <= 1 && succeeded; ++row)
+	{
+		for (s32 col = -1; col <= 1 && succeeded; ++col)
+		{
+			TemporaryMemory patchMemory = beginTemporaryMemory(arena);
+
+			GrassReferenceInput input;
+			getGrassReferenceInput(memory, packet, col, row, height, &input);
+
+			GrassReferenceOutput output;
+			succeeded = runGrassReference(platform, arena, &input, blades, NUM_BLADES_TO_GENERATE, &output) &&
+				rasterizeGrass(platform, arena, &target, &textures, output.vertices, output.vertexCount);
+
+			endTemporaryMemory(patchMemory);
+		}
+	}
+
+	if (succeeded)
+	{
+		succeeded = writeTGA(platform, arena, colourFile, target.colour, width, height) &&
+			(!depthFile || platform.writeFile(depthFile, target.depth, (u32)((u64)width*height*sizeof(f32))));
+	}
+	if (succeeded)
+		platform.debugOutput("Wrote the software render\n");
+	else
+		platform.debugOutput("The software render failed\n");
+
+	endTemporaryMemory(renderMemory);
+	return succeeded;
+}
+
+// renders the view at POSTER_WIDTH x POSTER_HEIGHT into POSTER_FILE. The poster's frustum is split into an off-axis
+// grid of POSTER_TILE_SIZE tiles that are rendered one at a time, each culled against its own part of the frustum,
+// and each tile's rows are written straight into their place in the file. Only one tile is ever in memory
+static void renderPoster(Platform platform, Memory* memory, FramePacket* packet)
+{
+	SimulationState* state = &packet->state;
+
+	s32 width = POSTER_WIDTH;
+	s32 height = POSTER_HEIGHT;
+	s32 tileSize = POSTER_TILE_SIZE;
+
+	MemoryArena* arena = &memory->frameArena;
+	TemporaryMemory posterMemory = beginTemporaryMemory(arena);
+
+	u8* tilePixels = TRY_PUSH_ARRAY(arena, (u64)tileSize*tileSize*4, u8);
+	u8* rowPixels = TRY_PUSH_ARRAY(arena, (u64)tileSize*4, u8);
+
+	//NOTE(denis): every tile is the full size, even the ones hanging off the poster's edges, so the multisampled
+	// framebuffer only has to be made once
+	Framebuffer tile = createFramebuffer(tileSize, tileSize);
+	void* file = platform.openWriteFile(POSTER_FILE);
+
+	TGAHeader header = getTGAHeader(width, height);
+	bool succeeded = tilePixels && rowPixels && tile.id && file &&
+		platform.writeFileAt(file, 0, &header, sizeof(header));
+
+	// the platform's framebuffer and viewport are put back once the poster is done
+	s32 targetFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFramebuffer);
+	s32 viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	Matrix4f projection = getProjectionTransform(&state->camera, width, height);
+
+	for (s32 tileY = 0; tileY*tileSize < height && succeeded; ++tileY)
+	{
+		for (s32 tileX = 0; tileX*tileSize < width && succeeded; ++tileX)
+		{
+			s32 x = tileX*tileSize;
+			s32 y = tileY*tileSize;
+
+			f32 left = -1.0f + 2.0f*(f32)x/(f32)width;
+			f32 right = -1.0f + 2.0f*(f32)(x + tileSize)/(f32)width;
+			f32 bottom = -1.0f + 2.0f*(f32)y/(f32)height;
+			f32 top = -1.0f + 2.0f*(f32)(y + tileSize)/(f32)height;
+
+			// cleared with the platform's clear colour, the same as a frame
+			glBindFramebuffer(GL_FRAMEBUFFER, tile.id);
+			glViewport(0, 0, tileSize, tileSize);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			Matrix4f tileProjection = getSubProjection(projection, left, right, bottom, top);
+			PatchDraw patches[FIELD_PATCH_COUNT];
+			u32 patchCount = cullField(state->objectTransform, tileProjection*packet->viewTransform,
+									   state->camera.pos, patches);
+
+			FrameStats tileStats = {};
+			render(memory, packet, tileProjection, patches, patchCount, &tileStats);
+
+			// a still doesn't mind waiting for the GPU, so this reads straight back instead of going through a PBO
+			s32 copyWidth = MIN(tileSize, width - x);
+			s32 copyHeight = MIN(tileSize, height - y);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, tile.id);
+			glReadBuffer(GL_COLOR_ATTACHMENT0);
+			glReadPixels(0, 0, copyWidth, copyHeight, GL_RGBA, GL_UNSIGNED_BYTE, tilePixels);
+
+			// both the tile and the TGA are bottom row first
+			for (s32 row = 0; row < copyHeight && succeeded; ++row)
+			{
+				copyRGBAToBGRA(rowPixels, tilePixels + (u64)row*copyWidth*4, copyWidth);
+
+				u64 offset = sizeof(TGAHeader) + ((u64)(y + row)*width + x)*4;
+				succeeded = platform.writeFileAt(file, offset, rowPixels, (u32)copyWidth*4);
+			}
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	deleteFramebuffer(&tile);
+	platform.closeWriteFile(file);
+
+	if (succeeded)
+		platform.debugOutput("Wrote the poster to " POSTER_FILE "\n");
+	else
+		platform.debugOutput("The poster failed\n");
+
+	endTemporaryMemory(posterMemory);
+}
+
+APP_UPDATE_CALL(appUpdate)
+{
+	clearArena(&memory->frameArena);
+
+	reloadChangedShaders(platform, memory, frameDelta);
+
+	s32 viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	//NOTE(denis): this frame's input is simulated into one packet while the GL thread draws the other one, which
+	// was simulated last frame. What's on screen is a frame behind the input in exchange for the simulation and
+	// culling being off the GL thread
+	FramePacket* simulatedPacket = &memory->framePackets[memory->simulatedPacket];
+
+	SimulationJob* job = &memory->simulationJob;
+	job->memory = memory;
+	job->input = *input;
+	job->frameDelta = frameDelta;
+	job->viewportWidth = viewport[2];
+	job->viewportHeight = viewport[3];
+	job->packet = simulatedPacket;
+	platform.addCountedWork(platform.workQueue, &memory->simulationCounter, simulateFrameJob, job);
+
+	// there's nothing to draw yet on the very first frame, so that one waits for its own packet. The packet is
+	// drawn again next frame, but the first simulate can't have requested anything since nothing was released
+	FramePacket* packet = &memory->framePackets[memory->simulatedPacket ^ 1];
+	if (!memory->framePacketReady)
+	{
+		platform.waitForCounter(platform.workQueue, &memory->simulationCounter);
+		packet = simulatedPacket;
+		memory->framePacketReady = true;
+	}
+
+	render(memory, packet, packet->projectionTransform, packet->visiblePatches, packet->visiblePatchCount,
+		   frameStats);
+
+	//NOTE(denis): none of these touch the simulation's half of the memory, so they can run alongside the job. Any
+	// of them waiting on their own work may end up running the simulation job on this thread, which is fine too
+	streamRegeneratedBlades(platform, memory, packet->regenerateBlades);
+
+	if (packet->softwareRenderRequested)
+	{
+		// the blades go on whatever the platform cleared the frame to
+		f32 clearColour[4];
+		glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColour);
+		renderSoftwareFrame(platform, memory, packet, viewport[2], viewport[3],
+							V4f(clearColour[0], clearColour[1], clearColour[2], clearColour[3]),
+							SOFTWARE_RENDER_FILE, SOFTWARE_RENDER_DEPTH_FILE);
+	}
+
+	// last, since it leaves the transforms of its final tile behind
+	if (packet->posterRequested)
+		renderPoster(platform, memory, packet);
+
+	platform.waitForCounter(platform.workQueue, &memory->simulationCounter);
+	memory->simulatedPacket ^= 1;
+}
+
+APP_RENDER_SOFTWARE_CALL(appRenderSoftware)
+{
+	initArenas(memory);
+	initField(memory);
+
+	MemoryArena* arena = &memory->permanentArena;
+	memory->forceMapImage = readReferenceImage(platform, arena, forceMapFile);
+	memory->heightMapImage = readReferenceImage(platform, arena, "terrain_heightmap.png");
+	memory->vegetationMapImage = readReferenceImage(platform, arena, "vegetation_map.png");
+
+	// the packet appInit's first frame would draw, the wind starts off
+	FramePacket* packet = &memory->framePackets[0];
+	*packet = {};
+	initSimulationState(&packet->state);
+	packet->viewTransform = calculateViewMatrix(&packet->state.camera);
+	packet->projectionTransform = getProjectionTransform(&packet->state.camera, SOFTWARE_RENDER_WIDTH,
+														 SOFTWARE_RENDER_HEIGHT);
+
+	return renderSoftwareFrame(platform, memory, packet, SOFTWARE_RENDER_WIDTH, SOFTWARE_RENDER_HEIGHT,
+							   V4f(TARGET_CLEAR_COLOUR), outputFile, 0);
+}
+
+// the blades, uniforms and reference triangles of a golden case, the arena has to be cleared by the caller.
+// Returns false if the case can't be run
+static bool runReferenceCase(Platform platform, Memory* memory, ReferenceGoldenHeader* golden, GrassBlade** blades,
+							 GrassReferenceInput* input, GrassReferenceOutput* output)
+{
+	MemoryArena* arena = &memory->frameArena;
+
+	// the case's blades are the start of the first chunk
+	u32 chunkSize = getBladeChunkSize(0);
+	*blades = TRY_PUSH_ARRAY(arena, chunkSize, GrassBlade);
+	if (golden->bladeCount > chunkSize || !*blades)
+		return false;
+
+	memory->bladeSeed = golden->bladeSeed;
+	BladeChunkGeneration generation;
+	initBladeChunkGeneration(&generation, memory, 0, *blades);
+	generateBladeChunkJob(&generation);
+
+	FramePacket packet = {};
+	initSimulationState(&packet.state);
+	Camera* camera = &packet.state.camera;
+	camera->pos = golden->cameraPos;
+	camera->target = golden->cameraTarget;
+	packet.state.time = golden->time;
+	packet.windActive = (u8)golden->windActive;
+	packet.viewTransform = calculateViewMatrix(camera);
+	packet.projectionTransform = getProjectionTransform(camera, (u32)golden->viewportWidth,
+														(u32)golden->viewportHeight);
+
+	getGrassReferenceInput(memory, &packet, golden->patchCol, golden->patchRow, golden->viewportHeight, input);
+	return runGrassReference(platform, arena, input, *blades, golden->bladeCount, output);
+}
+
+// draws the blades with a copy of the grass program that writes the tess eval shader's outputs into a buffer
+// instead of rasterizing them. Returns how many vertices were written to vertices, 0 if it couldn't capture them
+//NOTE(denis): the case's blades are uploaded over the start of the field's
+static u32 captureGrassVertices(Platform platform, Memory* memory, GrassReferenceInput* input, GrassBlade* blades,
+								u32 bladeCount, GrassReferenceVertex* vertices, u32 maxVertices)
+{
+	// transform feedback packs the outputs one after the other, which is exactly how GrassReferenceVertex is laid out
+	ASSERT(sizeof(GrassReferenceVertex) == 16*sizeof(f32));
+
+	u32 program = 0;
+	MappedFile shaderSources[SHADER_STAGE_COUNT];
+	if (readShaderSources(platform, _grassShaderFiles, shaderSources))
+	{
+		ProgramBuild build;
+		startProgramBuild(&build, _grassShaderFiles, shaderSources, 0, 0, _grassCaptureVaryings,
+						  ARRAY_COUNT(_grassCaptureVaryings));
+		program = finishProgramBuild(platform, &memory->frameArena, &build);
+	}
+	freeShaderSources(platform, shaderSources);
+
+	if (!program)
+		return 0;
+
+	// the uniforms are set by the same code as the grass program's, with the capture program swapped in for it
+	ShaderInfo* shaderInfo = &memory->shaderInfo;
+	u32 grassProgram = shaderInfo->grassProgram;
+	shaderInfo->grassProgram = program;
+	getUniformLocations(shaderInfo);
+	setConstantUniforms(memory);
+
+	Camera camera = {};
+	camera.pos = input->cameraPos;
+	updateShaderTransforms(input->projectionTransform, input->viewTransform, input->objectTransform, &camera,
+						   (s32)input->viewportHeight, shaderInfo);
+	glUniform2fv(shaderInfo->patchPos, 1, input->patchPos.e);
+	glUniform1i(shaderInfo->windActive, input->windActive);
+	glUniform1f(shaderInfo->time, input->time);
+
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, memory->forceMap);
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_2D, memory->heightMap);
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_2D, memory->vegetationMap);
+
+	glBindVertexArray(memory->grassVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, memory->grassVertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, bladeCount*sizeof(GrassBlade), blades);
+
+	u32 captureBuffer;
+	glGenBuffers(1, &captureBuffer);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, captureBuffer);
+	glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, maxVertices*sizeof(GrassReferenceVertex), 0, GL_STREAM_READ);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, captureBuffer);
+
+	u32 query;
+	glGenQueries(1, &query);
+
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, query);
+	glBeginTransformFeedback(GL_TRIANGLES);
+	glDrawArrays(GL_PATCHES, 0, bladeCount*4);
+	glEndTransformFeedback();
+	glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	u64 trianglesWritten = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &trianglesWritten);
+
+	u32 vertexCount = 0;
+	// a full buffer means the last blades didn't fit, comparing the ones that did would fail for the wrong reason
+	if (trianglesWritten > 0 && trianglesWritten*3 < maxVertices)
+	{
+		u32 capturedBytes = (u32)trianglesWritten*3*sizeof(GrassReferenceVertex);
+		void* captured = glMapBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, capturedBytes, GL_MAP_READ_BIT);
+		if (captured)
+		{
+			memcpy(vertices, captured, capturedBytes);
+			vertexCount = (u32)trianglesWritten*3;
+			glUnmapBuffer(GL_TRANSFORM_FEEDBACK_BUFFER);
+		}
+	}
+	else if (trianglesWritten > 0)
+	{
+		platform.debugOutput("The GPU wrote more vertices than the capture buffer holds\n");
+	}
+
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+	glDeleteBuffers(1, &captureBuffer);
+	glDeleteQueries(1, &query);
+
+	shaderInfo->grassProgram = grassProgram;
+	getUniformLocations(shaderInfo);
+	glDeleteProgram(program);
+
+	return vertexCount;
+}
+
+static void reportReferenceComparison(Platform platform, char* name, ReferenceComparison* comparison)
+{
+	char message[256];
+	snprintf(message, sizeof(message), "%s: %u of %u vertices out of tolerance, the furthest is %.4f pixels off\n",
+			 name, comparison->failedVertices, comparison->vertexCount, comparison->maxPixelError);
+	platform.debugOutput(message);
+}
+
+APP_CHECK_REFERENCE_CALL(appCheckReference)
+{
+	appInit(platform, memory, REFERENCE_CASE_FORCE_MAP);
+
+	MemoryArena* arena = &memory->frameArena;
+	TemporaryMemory checkMemory = beginTemporaryMemory(arena);
+
+	u64 goldenSize = 0;
+	void* goldenData = platform.readFile(goldenFile, arena, &goldenSize);
+	ReferenceGoldenHeader* golden = getReferenceGoldenHeader(goldenData, goldenSize);
+	if (!golden)
+	{
+		platform.debugOutput("The golden file is missing or was written by a different build\n");
+		endTemporaryMemory(checkMemory);
+		return false;
+	}
+
+	GrassBlade* blades;
+	GrassReferenceInput input;
+	GrassReferenceOutput output;
+	if (!runReferenceCase(platform, memory, golden, &blades, &input, &output))
+	{
+		platform.debugOutput("The golden case couldn't be run\n");
+		endTemporaryMemory(checkMemory);
+		return false;
+	}
+
+	s32 width = golden->viewportWidth;
+	s32 height = golden->viewportHeight;
+
+	ReferenceComparison goldenComparison;
+	compareReferenceRuns((GrassReferenceVertex*)(golden + 1), golden->vertexCount, output.vertices,
+						 output.vertexCount, width, height, &goldenComparison);
+	reportReferenceComparison(platform, "Reference against the golden file", &goldenComparison);
+
+	u32 maxVertices = golden->bladeCount*REFERENCE_CAPTURE_MAX_VERTICES_PER_BLADE;
+	GrassReferenceVertex* gpuVertices = TRY_PUSH_ARRAY(arena, maxVertices, GrassReferenceVertex);
+	u32 gpuVertexCount = 0;
+	if (gpuVertices)
+	{
+		gpuVertexCount = captureGrassVertices(platform, memory, &input, blades, golden->bladeCount, gpuVertices,
+											  maxVertices);
+	}
+
+	ReferenceComparison gpuComparison;
+	compareWithGPU(output.vertices, output.vertexCount, gpuVertices, gpuVertexCount, width, height, &gpuComparison);
+	reportReferenceComparison(platform, "Reference against the GPU", &gpuComparison);
+
+	bool passed = goldenComparison.failedVertices == 0 && gpuVertexCount > 0 && gpuComparison.failedVertices == 0;
+	if (passed)
+		platform.debugOutput("The reference check passed\n");
+	else
+		platform.debugOutput("The reference check failed\n");
+
+	endTemporaryMemory(checkMemory);
+	return passed;
+}
+
+APP_WRITE_REFERENCE_GOLDEN_CALL(appWriteReferenceGolden)
+{
+	initArenas(memory);
+	initField(memory);
+
+	MemoryArena* arena = &memory->permanentArena;
+	memory->forceMapImage = readReferenceImage(platform, arena, REFERENCE_CASE_FORCE_MAP);
+	memory->heightMapImage = readReferenceImage(platform, arena, "terrain_heightmap.png");
+	memory->vegetationMapImage = readReferenceImage(platform, arena, "vegetation_map.png");
+
+	ReferenceGoldenHeader golden = getDefaultReferenceCase();
+
+	GrassBlade* blades;
+	GrassReferenceInput input;
+	GrassReferenceOutput output;
+	if (!runReferenceCase(platform, memory, &golden, &blades, &input, &output))
+		return false;
+
+	golden.vertexCount = output.vertexCount;
+	u64 fileSize = sizeof(ReferenceGoldenHeader) + (u64)output.vertexCount*sizeof(GrassReferenceVertex);
+	u8* file = TRY_PUSH_ARRAY(&memory->frameArena, fileSize, u8);
+	if (!file)
+		return false;
+
+	memcpy(file, &golden, sizeof(ReferenceGoldenHeader));
+	memcpy(file + sizeof(ReferenceGoldenHeader), output.vertices, output.vertexCount*sizeof(GrassReferenceVertex));
+	return platform.writeFile(goldenFile, file, (u32)fileSize);
+}
@@ -3,6 +3,15 @@
 
 #define NUM_BLADES_TO_GENERATE 7500
 
+// blades are generated in chunks this big, each with its own random series so the chunks can be made on any
+// thread in any order and still come out the same
+#define BLADES_PER_CHUNK 500
+#define BLADE_CHUNK_COUNT ((NUM_BLADES_TO_GENERATE + BLADES_PER_CHUNK - 1)/BLADES_PER_CHUNK)
+
+// the most blade data that is uploaded in one frame when the blades are regenerated, whatever doesn't fit waits
+// for the next frame so regenerating never causes a hitch. Has to fit at least one chunk
+#define BLADE_UPLOAD_BUDGET KILOBYTE(512)
+
 #define DEG_TO_RAD(value) ((value)*(f32)M_PI/180.0f)
 #define CAMERA_FOV DEG_TO_RAD(15)
 
@@ -15,15 +24,192 @@
 #define MAX_CAMERA_HEIGHT 6.5f
 #define CAMERA_HEIGHT_MOVEMENT 0.025f
 
+#define SHADER_DIRECTORY "../shaders"
+#define GROUND_VERTEX_SHADER "../shaders/ground_vertex.glsl"
+#define GROUND_FRAGMENT_SHADER "../shaders/ground_fragment.glsl"
+#define GRASS_VERTEX_SHADER "../shaders/grass_vertex.glsl"
+#define GRASS_FRAGMENT_SHADER "../shaders/grass_fragment.glsl"
+#define GRASS_TESS_CONTROL_SHADER "../shaders/grass_tess_control.glsl"
+#define GRASS_TESS_EVAL_SHADER "../shaders/grass_tess_eval.glsl"
+
+// editors often save a file in more than one write, so we wait for the shader directory to be quiet this long
+// (in seconds) before rebuilding the programs
+#define SHADER_RELOAD_DELAY 0.1f
+
+// linked program binaries are kept here so we only compile the shaders when they (or the driver) change
+#define GROUND_PROGRAM_CACHE "../build/ground.programcache"
+#define GRASS_PROGRAM_CACHE "../build/grass.programcache"
+
+#define MAX_PATH_LENGTH 260
+
+// where F9 writes the grass drawn with the CPU rasterizer, the depth is raw 32 bit floats bottom row first
+#define SOFTWARE_RENDER_FILE "../build/software_render.tga"
+#define SOFTWARE_RENDER_DEPTH_FILE "../build/software_render_depth.raw"
+// the size of a software render made without a window
+#define SOFTWARE_RENDER_WIDTH 1280
+#define SOFTWARE_RENDER_HEIGHT 720
+
+// F8 renders the current view at poster size into POSTER_FILE. The poster is drawn in square tiles, so its size
+// isn't limited by how big a framebuffer can be (a TGA can be up to 65535 pixels a side)
+#define POSTER_FILE "../build/poster.tga"
+#define POSTER_WIDTH 7680
+#define POSTER_HEIGHT 4320
+#define POSTER_TILE_SIZE 1024
+
+// the Memory struct sits at the start of the platform's memory block and the rest is split into two arenas. The
+// permanent arena holds whatever lives as long as the app does, the frame arena gets everything else and is
+// cleared at the start of every update (appInit uses it for loading and gives it all back when it's done)
+#define PERMANENT_ARENA_SIZE MEGABYTE(64)
+
+// each texture load job gets a sub arena this big out of the frame arena, since arenas can't be shared between
+// threads. Only textures that have to be decoded use it, containers are mapped
+#define TEXTURE_LOAD_ARENA_SIZE MEGABYTE(8)
+
+// TextureLoad flags
+#define TEXTURE_MIPMAPPED 0x1
+// the mask is kept in a single channel, and its mips are built on the CPU and thresholded back to black and white
+// so that it covers the same fraction of the texture at every level, otherwise distant blades get fatter as the
+// cut out areas blur away
+#define TEXTURE_COVERAGE_MASK 0x2
+
+// the most images that can be loaded into the layers of one texture array
+#define MAX_TEXTURE_LAYERS 8
+
+// clamped to whatever the driver supports, 1.0 turns anisotropic filtering off
+#define MAX_TEXTURE_ANISOTROPY 8.0f
+
+// samples per pixel of the framebuffer the scene is drawn into, blade edges are antialiased with
+// alpha-to-coverage from the mask. 0 or 1 draws straight into the platform's framebuffer with a hard cut out
+#define MSAA_SAMPLES 4
+
+// the ground under every grass patch is a grid of this many quads a side, displaced by the heightmap in the
+// vertex shader. Each level of detail halves the grid, so this has to divide by 2^(TERRAIN_LOD_COUNT-1)
+#define TERRAIN_GRID_RESOLUTION 32
+#define TERRAIN_LOD_COUNT 4
+// a patch drops a level of detail for every this far (in world units) it is from the camera
+#define TERRAIN_LOD_DISTANCE 2.0f
+// the heightmap's [0, 1] is scaled to this many world units
+#define TERRAIN_HEIGHT_SCALE 0.3f
+#define TERRAIN_SKIRT_DEPTH 0.05f
+
+// how far past the edges of its patch a blade can reach (the widest leaf bent as far as the wind and the force
+// map can push it) and how high above the ground it can get, patches are culled with a box that includes these
+#define PATCH_BLADE_REACH 0.65f
+#define PATCH_BLADE_HEIGHT 0.4f
+
+// blades are tessellated into one segment for about this many pixels of their height on screen, up to the
+// tessellation control shader's maximum
+#define GRASS_PIXELS_PER_SEGMENT 8.0f
+// blades whose width across the view covers fewer pixels than this are dropped, they would only be a sliver for a
+// full blade of triangles. Blades are a few millimetres wide, so at 1080p this takes blades seen edge-on up close
+// and the thinnest ones facing the camera near the max distance, where they miss most of the samples anyway
+#define GRASS_MIN_FACING_PIXELS 0.25f
+
+// the vegetation map picks one of this many blade species for every blade, its [0, 1] is split into this many
+// equal ranges. SPECIES_COUNT in the grass shaders has to match
+#define BLADE_SPECIES_COUNT 3
+
+// the field is a 3x3 grid of patches that all draw the same blades
+#define FIELD_PATCH_COUNT 9
+
 #define NEAR_PLANE 0.5f
 #define FAR_PLANE 30.0f
 
+// the simulation always advances in steps of this size, no matter how fast we render
+#define SIMULATION_TIMESTEP (1.0f/60.0f)
+#define MAX_FRAME_DELTA 0.25f
+#define WIND_TIME_PER_STEP 0.03f
+
 
 typedef struct {
 	v4f v[16];
 	v4f& operator[](u32 index) { return v[index]; }
 } GrassBlade;
 
+struct RandomSeries
+{
+	u32 state;
+};
+
+// a texture that has been read (and decoded if there was no container) but not handed to GL yet
+struct TextureData
+{
+	TextureFormat format;
+	u32 levelCount;
+	TextureLevel levels[TEXTURE_MAX_LEVELS];
+	u8* levelData[TEXTURE_MAX_LEVELS];
+
+	// the driver builds the rest of the mip chain from the first level
+	bool generateMipmaps;
+
+	// only the one for wherever the texture came from is set, the levels point straight into it
+	MappedFile container;
+	u8* decodedPixels;
+};
+
+// what makes one kind of blade look different from another, the grass shaders get a uniform array of each
+struct BladeSpecies
+{
+	// layers of the alpha and diffuse texture arrays
+	s32 alphaLayer;
+	s32 diffuseLayer;
+
+	// scales the generated blade's width and height, and how far its tip bends
+	f32 widthScale;
+	f32 heightScale;
+	f32 bendingScale;
+
+	// the diffuse colour is tinted from rootColour to tipColour along the blade
+	v3f rootColour;
+	v3f tipColour;
+};
+
+// a CPU copy of the first level of a texture for code that has to sample it the way the shaders do (see
+// grass_reference.h). Texels are unorm bytes, and 0 pixels samples as black
+struct ReferenceImage
+{
+	u8* pixels;
+	s32 width;
+	s32 height;
+	s32 componentCount;
+};
+
+//NOTE(denis): the loads below are filled in by jobs during appInit, and they only live on appInit's stack
+
+struct TextureLoad
+{
+	Platform platform;
+	MemoryArena arena;
+	char* imageFile;
+	u32 flags;
+
+	TextureData texture;
+};
+
+struct ShaderLoad
+{
+	Platform platform;
+	char** shaderFiles;
+	// 0 when the driver can't give us program binaries
+	char* cacheFile;
+	u64 driverHash;
+
+	bool sourcesRead;
+	MappedFile shaderSources[SHADER_STAGE_COUNT];
+	u64 cacheKey;
+	MappedFile cache;
+};
+
+// one chunk of blades for a job to generate straight into wherever it will be uploaded from
+struct BladeChunkGeneration
+{
+	v3f* grassPlane;
+	u32 seed;
+	u32 chunkIndex;
+
+	GrassBlade* blades;
+};
+
 struct ShaderInfo
 {
 	u32 groundProgram;
@@ -38,9 +224,26 @@ struct ShaderInfo
 	u32 grassProjectionTransform;
 
 	u32 cameraPos;
+	u32 viewportHeight;
+	u32 projectionScale;
 	u32 time;
 	u32 windActive;
 	u32 patchPos;
+	u32 groundPatchPos;
+};
+
+// the patch grid is shared by every level of detail, each level only has its own indices
+struct TerrainMesh
+{
+	u32 indexBuffers[TERRAIN_LOD_COUNT];
+	u32 indexCounts[TERRAIN_LOD_COUNT];
+};
+
+// the planes are (normal, distance) with the normals pointing in, a point p is inside a plane when
+// dot(normal, p) + distance >= 0
+struct Frustum
+{
+	v4f planes[6];
 };
 
 struct Camera
@@ -54,26 +257,126 @@ struct Camera
 	v3f upDir;
 };
 
+// everything the simulation advances, the previous and current states are interpolated for rendering
+struct SimulationState
+{
+	Camera camera;
+	Matrix4f objectTransform;
+
+	f32 time;
+};
+
+// a patch that survived culling, with everything needed to draw it
+struct PatchDraw
+{
+	Matrix4f transform;
+	v2f patchPos;
+	u32 terrainLOD;
+};
+
+// everything the GL thread needs to draw a frame. A simulation job fills one in while the GL thread draws the one
+// the previous update made, and once it's handed over nothing writes to it
+struct FramePacket
+{
+	// the simulation state interpolated to where the frame is drawn
+	SimulationState state;
+	Matrix4f viewTransform;
+	Matrix4f projectionTransform;
+	u8 windActive;
+
+	u32 visiblePatchCount;
+	PatchDraw visiblePatches[FIELD_PATCH_COUNT];
+
+	// made by this frame's input, the GL thread acts on them
+	bool regenerateBlades;
+	bool softwareRenderRequested;
+	bool posterRequested;
+};
+
+struct Memory;
+
+struct SimulationJob
+{
+	Memory* memory;
+	Input input;
+	f32 frameDelta;
+
+	// the size of the target when the job was started, the job can't ask GL for it
+	s32 viewportWidth;
+	s32 viewportHeight;
+
+	FramePacket* packet;
+};
+
 struct Memory
 {
+	MemoryArena permanentArena;
+	MemoryArena frameArena;
+
 	ShaderInfo shaderInfo;
+
+	// hot reloading, a build's program is 0 when there is nothing in flight. A program stays pending from the
+	// change until its rebuild could be started
+	void* shaderWatch;
+	f32 shaderReloadDelay;
+	bool groundReloadPending;
+	bool grassReloadPending;
+	ProgramBuild groundProgramBuild;
+	ProgramBuild grassProgramBuild;
 	
 	u32 groundVAO;
+	TerrainMesh terrain;
 	u32 grassVAO;
+	u32 grassVertexBuffer;
+	v3f grassPlane[4];
+
+	// regenerated blades are streamed into grassVertexBuffer over as many frames as BLADE_UPLOAD_BUDGET needs,
+	// nextBladeChunk is BLADE_CHUNK_COUNT when there's nothing left to stream
+	StreamBuffer bladeStream;
+	u32 bladeSeed;
+	u32 nextBladeChunk;
 
 	u32 alphaTexture;
 	u32 diffuseTexture;
 	u32 forceMap;
+	u32 heightMap;
+	u32 vegetationMap;
+	// the maps the grass vertex shader samples, kept for the CPU reference of the grass program
+	ReferenceImage forceMapImage;
+	ReferenceImage heightMapImage;
+	ReferenceImage vegetationMapImage;
 	
 	u32 numBladeVertices;
+	v3f fieldRect[2];
 
-	Camera camera;
-	
+	// clamped to what the driver supports in appInit, and 0 if the multisampled framebuffer can't be made
+	u32 msaaSamples;
+	Framebuffer msaaFramebuffer;
+
+	// bytes of vertex and texture data we have handed to the GPU
+	u64 gpuMemoryBytes;
+
+	//NOTE(denis): the simulation state, windActive, cameraRotation, lastMousePos and oldController belong to the
+	// simulation job while it's running, the GL thread only sees them through the frame packets
+	SimulationState previousState;
+	SimulationState currentState;
+	f32 timeAccumulator;
+
+	// packets are simulated into one after the other, the one that isn't being simulated is the one being drawn
+	SimulationJob simulationJob;
+	WorkCounter simulationCounter;
+	FramePacket framePackets[2];
+	u32 simulatedPacket;
+	// false until the first packet has been simulated
+	bool framePacketReady;
+
+	// the transforms used for the frame currently being rendered
 	Matrix4f viewTransform;
 	Matrix4f projectionTransform;
 	Matrix4f objectTransform;
 
     u8 windActive;
+	f32 cameraRotation;
 	
 	v2 lastMousePos;
 	//TODO(denis): this should be part of the controller struct instead
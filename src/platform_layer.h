@@ -3,6 +3,7 @@
 
 #include "denis_types.h"
 #include "denis_math.h"
+#include "denis_memory.h"
 
 //TODO(denis): this doesn't take into account that the pitch may be different from the width of
 // the image
@@ -24,6 +25,8 @@ struct Controller
 	bool rightPressed;
 
 	bool actionPressed;
+	bool softwareRenderPressed;
+	bool posterPressed;
 };
 
 struct Mouse
@@ -62,15 +65,108 @@ struct Input
 	Touch touch;
 	Mouse mouse;
 	Controller controller;
+
+	// radians to orbit the camera around the field this step, on top of whatever the mouse does. Only scripted
+	// input sets it, so a camera path can turn by an exact angle rather than a whole number of pixels
+	f32 cameraTurn;
+};
+
+// filled in by the app every frame so the platform layer can report on what was drawn
+struct FrameStats
+{
+	u32 bladesSubmitted;
+	u32 drawCalls;
+	u64 gpuMemoryBytes;
+	// the most of the app's memory block that has ever been in use
+	u64 arenaPeakBytes;
+};
+
+// a read-only view of a whole file, straight out of the OS's file cache
+struct MappedFile
+{
+	void* data;
+	u64 size;
+};
+
+// defined by the platform layer, the app only ever holds a pointer to it
+struct WorkQueue;
+
+#define WORK_QUEUE_CALLBACK(name) void (name)(void* data)
+typedef WORK_QUEUE_CALLBACK(WorkQueueCallback);
+
+// does the items [first, onePastLast) of a parallelFor
+#define WORK_RANGE_CALLBACK(name) void (name)(void* data, u32 first, u32 onePastLast)
+typedef WORK_RANGE_CALLBACK(WorkRangeCallback);
+
+// how many of the pieces of work added with this counter haven't finished yet. Waiting for a counter to reach 0 is
+// how work depends on other work, so start it at {} and keep it alive until it has been waited for
+struct WorkCounter
+{
+	volatile s32 pending;
 };
 
 struct Platform
 {
-	void*(*readFile)(char* fileName);
+	// the returned data is 0 terminated and pushed onto the arena, returns 0 if the file can't be read or doesn't
+	// fit. dataSize is optional
+	void*(*readFile)(char* fileName, MemoryArena* arena, u64* dataSize);
+	bool(*writeFile)(char* fileName, void* data, u32 dataSize);
+
+	// for files too big to stage in memory. openWriteFile replaces the file and returns 0 if it can't be created,
+	// every write goes to the given offset. closeWriteFile is safe to call with 0
+	void*(*openWriteFile)(char* fileName);
+	bool(*writeFileAt)(void* file, u64 offset, void* data, u32 dataSize);
+	void(*closeWriteFile)(void* file);
+
+	// nothing is allocated or copied, but the view is NOT 0 terminated. mapFile returns false for missing or empty
+	// files, and unmapFile is safe to call on a file that was never mapped. Both can be called from any thread
+	bool(*mapFile)(char* fileName, MappedFile* file);
+	void(*unmapFile)(MappedFile* file);
+	void(*debugOutput)(char* message);
+
+	// watchDirectory returns 0 on failure, directoryChanged and unwatchDirectory are safe to call with 0
+	void*(*watchDirectory)(char* directory);
+	bool(*directoryChanged)(void* watch);
+	void(*unwatchDirectory)(void* watch);
+
+	// work added to the queue runs on worker threads, so it must not touch GL. Work can be added from the main
+	// thread or from inside other work on the same queue, and idle threads steal it from whichever thread added it.
+	// completeAllWork helps out with the queue until everything added so far has finished, it is only for the main
+	// thread outside of any work. Inside work, wait on a counter instead
+	WorkQueue* workQueue;
+	void(*addWork)(WorkQueue* queue, WorkQueueCallback* callback, void* data);
+	void(*completeAllWork)(WorkQueue* queue);
+
+	// the counter goes up when the work is added and down once it has finished. Waiting helps out with the queue
+	// until the counter is 0, so it's safe to do from inside work
+	void(*addCountedWork)(WorkQueue* queue, WorkCounter* counter, WorkQueueCallback* callback, void* data);
+	void(*waitForCounter)(WorkQueue* queue, WorkCounter* counter);
+
+	// splits [0, count) into ranges of at least minBatchSize items spread over the queue's threads, and returns
+	// once they're all done. The calling thread does a range itself, and it's safe to call from inside work
+	void(*parallelFor)(WorkQueue* queue, u32 count, u32 minBatchSize, WorkRangeCallback* callback, void* data);
 };
 
+#define APP_MEMORY_SIZE MEGABYTE(256)
+
+// what the platform clears every frame to before the app draws
+#define TARGET_CLEAR_COLOUR 0.4f, 0.5f, 0.7f, 1.0f
+
 #define APP_INIT_CALL(name) void (name)(Platform platform, Memory* memory, char* forceMapFile)
-#define APP_UPDATE_CALL(name) void (name)(Platform platform, Memory* memory, Input* input)
+// frameDelta is the real time in seconds since the last update
+#define APP_UPDATE_CALL(name) void (name)(Platform platform, Memory* memory, Input* input, f32 frameDelta, \
+										  FrameStats* frameStats)
+// releases anything the app holds outside of its memory block, call it before the memory is freed
+#define APP_SHUTDOWN_CALL(name) void (name)(Platform platform, Memory* memory)
+// draws the first frame with the CPU rasterizer into outputFile, in place of appInit and without GL. Returns false
+// if it couldn't
+#define APP_RENDER_SOFTWARE_CALL(name) bool (name)(Platform platform, Memory* memory, char* forceMapFile, \
+												   char* outputFile)
+// runs the golden case in goldenFile through the CPU reference and compares it with the golden triangles and with
+// what the GPU draws, in place of appInit. Returns false if anything is out of tolerance
+#define APP_CHECK_REFERENCE_CALL(name) bool (name)(Platform platform, Memory* memory, char* goldenFile)
+// writes a new golden case to goldenFile from the CPU reference, in place of appInit and without GL
+#define APP_WRITE_REFERENCE_GOLDEN_CALL(name) bool (name)(Platform platform, Memory* memory, char* goldenFile)
 
 #if defined(DENIS_WIN32) && !defined(PLATFORM_IMPLEMENTATION)
 #include "win32_layer.cpp"
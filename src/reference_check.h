@@ -0,0 +1,252 @@
+#if !defined(REFERENCE_CHECK_H_)
+#define REFERENCE_CHECK_H_
+
+// A golden case is a fixed seed, camera and patch along with the triangles the CPU reference drew for them. The
+// check mode runs the case through the reference again and compares it with the golden triangles, then draws the
+// same blades on the GPU with transform feedback on and compares what the tess eval shader wrote out with the
+// reference. The first catches changes to the reference, the second catches it and the shaders drifting apart.
+//
+// Golden file layout:
+//  ReferenceGoldenHeader
+//  vertexCount GrassReferenceVertex, as runGrassReference wrote them
+//
+//NOTE(denis): the vertices are written out as raw bytes, so vertexSize in the header is used to catch a build
+// with a different GrassReferenceVertex
+
+#define REFERENCE_GOLDEN_MAGIC 0x44475247 // "GRGD"
+#define REFERENCE_GOLDEN_VERSION 1
+
+// the case -reference-update writes. Only the first blades of the field are drawn, which keeps the file small
+#define REFERENCE_CASE_SEED 1234
+#define REFERENCE_CASE_BLADES 64
+#define REFERENCE_CASE_WIDTH 1280
+#define REFERENCE_CASE_HEIGHT 720
+#define REFERENCE_CASE_TIME 1.5f
+#define REFERENCE_CASE_FORCE_MAP "default_force_map.png"
+
+// two runs of the reference should give the same answer, this only leaves room for a different compiler
+#define REFERENCE_GOLDEN_PIXEL_TOLERANCE 0.01f
+#define REFERENCE_GOLDEN_ATTRIBUTE_TOLERANCE 0.0001f
+// the GPU rounds differently and filters the force map in hardware, in pixels of the case's viewport
+#define REFERENCE_GPU_PIXEL_TOLERANCE 0.5f
+// a GPU vertex belongs to the reference blade whose centre is this close to its own, in world units
+#define REFERENCE_GPU_CENTRE_TOLERANCE 0.001f
+
+// the GPU tessellates across the blade as well, inner levels of up to REFERENCE_MAX_TESS_LEVEL both ways
+// come out as less than this many vertices
+#define REFERENCE_CAPTURE_MAX_VERTICES_PER_BLADE (REFERENCE_MAX_TESS_LEVEL*REFERENCE_MAX_TESS_LEVEL*12)
+
+struct ReferenceGoldenHeader
+{
+	u32 magic;
+	u32 version;
+	u32 vertexSize;
+
+	u32 bladeSeed;
+	u32 bladeCount;
+	s32 patchCol;
+	s32 patchRow;
+
+	v3f cameraPos;
+	v3f cameraTarget;
+	f32 time;
+	u32 windActive;
+	s32 viewportWidth;
+	s32 viewportHeight;
+
+	u32 vertexCount;
+};
+
+struct ReferenceComparison
+{
+	u32 vertexCount;
+	u32 failedVertices;
+	f32 maxPixelError;
+};
+
+static ReferenceGoldenHeader getDefaultReferenceCase()
+{
+	ReferenceGoldenHeader result = {};
+	result.magic = REFERENCE_GOLDEN_MAGIC;
+	result.version = REFERENCE_GOLDEN_VERSION;
+	result.vertexSize = sizeof(GrassReferenceVertex);
+
+	result.bladeSeed = REFERENCE_CASE_SEED;
+	result.bladeCount = REFERENCE_CASE_BLADES;
+	result.patchCol = 0;
+	result.patchRow = 0;
+
+	// far enough that the blades get a spread of tessellation levels, with the wind blowing
+	result.cameraPos = V3f(0.0f, 5.5f, 11.0f);
+	result.cameraTarget = V3f(0.0f, 0.0f, 0.0f);
+	result.time = REFERENCE_CASE_TIME;
+	result.windActive = 1;
+	result.viewportWidth = REFERENCE_CASE_WIDTH;
+	result.viewportHeight = REFERENCE_CASE_HEIGHT;
+
+	return result;
+}
+
+// returns the header of a golden file that this build can read, or 0
+static ReferenceGoldenHeader* getReferenceGoldenHeader(void* data, u64 dataSize)
+{
+	if (!data || dataSize < sizeof(ReferenceGoldenHeader))
+		return 0;
+
+	ReferenceGoldenHeader* header = (ReferenceGoldenHeader*)data;
+	if (header->magic != REFERENCE_GOLDEN_MAGIC || header->version != REFERENCE_GOLDEN_VERSION ||
+		header->vertexSize != sizeof(GrassReferenceVertex))
+		return 0;
+
+	if (dataSize != sizeof(ReferenceGoldenHeader) + (u64)header->vertexCount*sizeof(GrassReferenceVertex))
+		return 0;
+
+	return header;
+}
+
+//NOTE(denis): a vertex behind the camera has no pixel, so those are measured in clip space scaled up to pixels
+// at w = 1 instead
+static inline v2f getReferencePixelPos(v4f clipPos, s32 width, s32 height)
+{
+	f32 w = clipPos.w > FLT_EPSILON ? clipPos.w : 1.0f;
+	return V2f((clipPos.x/w*0.5f + 0.5f)*width, (clipPos.y/w*0.5f + 0.5f)*height);
+}
+
+static inline f32 getPixelDistance(v2f a, v2f b)
+{
+	f32 x = a.x - b.x;
+	f32 y = a.y - b.y;
+	return sqrtf(x*x + y*y);
+}
+
+static f32 getSegmentDistance(v2f point, v2f a, v2f b)
+{
+	f32 edgeX = b.x - a.x;
+	f32 edgeY = b.y - a.y;
+	f32 lengthSquared = edgeX*edgeX + edgeY*edgeY;
+
+	f32 t = 0.0f;
+	if (lengthSquared > 0.0f)
+		t = CLAMP_RANGE(((point.x - a.x)*edgeX + (point.y - a.y)*edgeY)/lengthSquared, 0.0f, 1.0f);
+
+	return getPixelDistance(point, V2f(a.x + edgeX*t, a.y + edgeY*t));
+}
+
+// 0 when the point is inside the triangle (either winding), otherwise how far it is from the nearest edge
+static f32 getTriangleDistance(v2f point, v2f a, v2f b, v2f c)
+{
+	f32 edge0 = (b.x - a.x)*(point.y - a.y) - (b.y - a.y)*(point.x - a.x);
+	f32 edge1 = (c.x - b.x)*(point.y - b.y) - (c.y - b.y)*(point.x - b.x);
+	f32 edge2 = (a.x - c.x)*(point.y - c.y) - (a.y - c.y)*(point.x - c.x);
+	if ((edge0 >= 0.0f && edge1 >= 0.0f && edge2 >= 0.0f) || (edge0 <= 0.0f && edge1 <= 0.0f && edge2 <= 0.0f))
+		return 0.0f;
+
+	return MIN(getSegmentDistance(point, a, b), MIN(getSegmentDistance(point, b, c), getSegmentDistance(point, c, a)));
+}
+
+static inline bool attributesMatch(f32* expected, f32* actual, u32 count, f32 tolerance)
+{
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (!(fabsf(expected[i] - actual[i]) <= tolerance))
+			return false;
+	}
+
+	return true;
+}
+
+// the reference always writes its vertices in the same order, so two runs of it are compared one to one
+static void compareReferenceRuns(GrassReferenceVertex* expected, u32 expectedCount, GrassReferenceVertex* actual,
+								 u32 actualCount, s32 width, s32 height, ReferenceComparison* result)
+{
+	*result = {};
+	result->vertexCount = MAX(expectedCount, actualCount);
+	// every vertex one of them has and the other doesn't is a failure
+	result->failedVertices = result->vertexCount - MIN(expectedCount, actualCount);
+
+	for (u32 i = 0; i < MIN(expectedCount, actualCount); ++i)
+	{
+		GrassReferenceVertex* a = &expected[i];
+		GrassReferenceVertex* b = &actual[i];
+
+		f32 pixelError = getPixelDistance(getReferencePixelPos(a->clipPos, width, height),
+										  getReferencePixelPos(b->clipPos, width, height));
+		result->maxPixelError = MAX(result->maxPixelError, pixelError);
+
+		f32 tolerance = REFERENCE_GOLDEN_ATTRIBUTE_TOLERANCE;
+		bool matches = pixelError <= REFERENCE_GOLDEN_PIXEL_TOLERANCE &&
+			attributesMatch(a->centrePos.e, b->centrePos.e, 3, tolerance) &&
+			attributesMatch(a->normal.e, b->normal.e, 3, tolerance) &&
+			attributesMatch(a->texturePos.e, b->texturePos.e, 2, tolerance) &&
+			attributesMatch(a->random.e, b->random.e, 3, tolerance) &&
+			a->species == b->species;
+		if (!matches)
+			++result->failedVertices;
+	}
+}
+
+static inline bool sameBlade(GrassReferenceVertex* a, GrassReferenceVertex* b)
+{
+	return attributesMatch(a->centrePos.e, b->centrePos.e, 3, REFERENCE_GPU_CENTRE_TOLERANCE);
+}
+
+// How the GPU splits a blade into triangles is up to the driver (see grass_reference.h), so its vertices can't be
+// compared one to one. Each GPU vertex is matched to the reference blade with the same centre and has to land on
+// one of that blade's triangles, and each reference vertex has to have a GPU vertex on it, which catches a blade
+// that was tessellated into a different number of rows
+static void compareWithGPU(GrassReferenceVertex* reference, u32 referenceCount, GrassReferenceVertex* gpu,
+						   u32 gpuCount, s32 width, s32 height, ReferenceComparison* result)
+{
+	*result = {};
+	result->vertexCount = referenceCount + gpuCount;
+
+	for (u32 i = 0; i < gpuCount; ++i)
+	{
+		GrassReferenceVertex* vertex = &gpu[i];
+		v2f pixel = getReferencePixelPos(vertex->clipPos, width, height);
+
+		f32 pixelError = FLT_MAX;
+		bool speciesMatches = false;
+		for (u32 triangle = 0; triangle + 2 < referenceCount; triangle += 3)
+		{
+			GrassReferenceVertex* corners = &reference[triangle];
+			if (!sameBlade(vertex, corners))
+				continue;
+
+			f32 distance = getTriangleDistance(pixel, getReferencePixelPos(corners[0].clipPos, width, height),
+											   getReferencePixelPos(corners[1].clipPos, width, height),
+											   getReferencePixelPos(corners[2].clipPos, width, height));
+			pixelError = MIN(pixelError, distance);
+			speciesMatches = corners[0].species == vertex->species;
+		}
+
+		// a vertex without a blade only counts as a failure, it has no distance
+		if (pixelError < FLT_MAX)
+			result->maxPixelError = MAX(result->maxPixelError, pixelError);
+		if (!(pixelError <= REFERENCE_GPU_PIXEL_TOLERANCE) || !speciesMatches)
+			++result->failedVertices;
+	}
+
+	for (u32 i = 0; i < referenceCount; ++i)
+	{
+		GrassReferenceVertex* vertex = &reference[i];
+		v2f pixel = getReferencePixelPos(vertex->clipPos, width, height);
+
+		f32 pixelError = FLT_MAX;
+		for (u32 j = 0; j < gpuCount; ++j)
+		{
+			if (sameBlade(vertex, &gpu[j]))
+			{
+				v2f gpuPixel = getReferencePixelPos(gpu[j].clipPos, width, height);
+				pixelError = MIN(pixelError, getPixelDistance(pixel, gpuPixel));
+			}
+		}
+
+		if (pixelError < FLT_MAX)
+			result->maxPixelError = MAX(result->maxPixelError, pixelError);
+		if (!(pixelError <= REFERENCE_GPU_PIXEL_TOLERANCE))
+			++result->failedVertices;
+	}
+}
+
+#endif
@@ -0,0 +1,139 @@
+#if !defined(TEXTURE_CONTAINER_H_)
+#define TEXTURE_CONTAINER_H_
+
+// Texture container file layout (written by texture_converter, read by the app):
+//  TextureContainerHeader
+//  TextureLevel for every mip level, largest first
+//  the data for every level, already in the format the GPU wants
+//
+//NOTE(denis): the offsets are from the start of the file so a level can be uploaded straight out of the file
+// contents without any decoding
+
+#define TEXTURE_CONTAINER_MAGIC 0x58455444 // "DTEX"
+#define TEXTURE_CONTAINER_VERSION 1
+#define TEXTURE_CONTAINER_EXTENSION ".dtex"
+
+#define TEXTURE_MAX_LEVELS 16
+
+enum TextureFormat
+{
+	TEXTURE_FORMAT_RGBA8,
+	// 4x4 blocks of 8 bytes, RGB only
+	TEXTURE_FORMAT_BC1,
+	// 4x4 blocks of 8 bytes, red only
+	TEXTURE_FORMAT_BC4,
+	// 4x4 blocks of 16 bytes, red and green
+	TEXTURE_FORMAT_BC5,
+	// uncompressed, red only
+	TEXTURE_FORMAT_R8,
+
+	TEXTURE_FORMAT_COUNT
+};
+
+struct TextureContainerHeader
+{
+	u32 magic;
+	u32 version;
+
+	u32 format;
+	u32 width;
+	u32 height;
+	u32 levelCount;
+};
+
+struct TextureLevel
+{
+	u32 width;
+	u32 height;
+
+	u32 offset;
+	u32 size;
+};
+
+static u32 getTextureLevelSize(TextureFormat format, u32 width, u32 height)
+{
+	u32 blocks = ((width + 3)/4)*((height + 3)/4);
+
+	switch (format)
+	{
+		case TEXTURE_FORMAT_RGBA8: return width*height*4;
+		case TEXTURE_FORMAT_R8: return width*height;
+		case TEXTURE_FORMAT_BC1:
+		case TEXTURE_FORMAT_BC4: return blocks*8;
+		case TEXTURE_FORMAT_BC5: return blocks*16;
+		default: return 0;
+	}
+}
+
+//NOTE(denis): a mask texel counts as part of the blade when its first channel is at least this, the fragment
+// shader discards against the same value
+#define MASK_COVERAGE_THRESHOLD 128
+
+// returns the fraction of texels in the image that are part of the blade
+static f32 getMaskCoverage(u8* pixels, s32 width, s32 height, s32 componentCount)
+{
+	u32 coveredTexels = 0;
+	for (s32 i = 0; i < width*height; ++i)
+	{
+		if (pixels[i*componentCount] >= MASK_COVERAGE_THRESHOLD)
+			++coveredTexels;
+	}
+
+	return (f32)coveredTexels/(f32)(width*height);
+}
+
+// box filters the source down to the next mip level, odd edges reuse the last row/column
+static void downsampleTexture(u8* source, s32 sourceWidth, s32 sourceHeight, u8* dest, s32 destWidth, s32 destHeight,
+							  s32 componentCount)
+{
+	for (s32 y = 0; y < destHeight; ++y)
+	{
+		s32 y0 = MIN(y*2, sourceHeight-1);
+		s32 y1 = MIN(y*2 + 1, sourceHeight-1);
+
+		for (s32 x = 0; x < destWidth; ++x)
+		{
+			s32 x0 = MIN(x*2, sourceWidth-1);
+			s32 x1 = MIN(x*2 + 1, sourceWidth-1);
+
+			for (s32 channel = 0; channel < componentCount; ++channel)
+			{
+				u32 sum = source[(y0*sourceWidth + x0)*componentCount + channel] +
+					source[(y0*sourceWidth + x1)*componentCount + channel] +
+					source[(y1*sourceWidth + x0)*componentCount + channel] +
+					source[(y1*sourceWidth + x1)*componentCount + channel];
+				dest[(y*destWidth + x)*componentCount + channel] = (u8)((sum + 2)/4);
+			}
+		}
+	}
+}
+
+// turns a filtered mask level back into pure black and white, picking the threshold that gets closest to the
+// wanted coverage. Alpha is left alone when there is one
+static void thresholdMaskLevel(u8* pixels, s32 width, s32 height, s32 componentCount, f32 coverage)
+{
+	u32 histogram[256] = {};
+	for (s32 i = 0; i < width*height; ++i)
+		++histogram[pixels[i*componentCount]];
+
+	u32 wantedTexels = (u32)(coverage*(f32)(width*height) + 0.5f);
+
+	// walk down from white until enough texels are covered
+	u32 threshold = 255;
+	u32 coveredTexels = histogram[255];
+	while (threshold > 0 && coveredTexels < wantedTexels)
+	{
+		--threshold;
+		coveredTexels += histogram[threshold];
+	}
+
+	s32 colourComponents = MIN(componentCount, 3);
+	for (s32 i = 0; i < width*height; ++i)
+	{
+		u8 value = (pixels[i*componentCount] >= threshold && wantedTexels > 0) ? 255 : 0;
+		for (s32 channel = 0; channel < colourComponents; ++channel)
+			pixels[i*componentCount + channel] = value;
+	}
+}
+
+#endif
@@ -0,0 +1,370 @@
+// Offline tool that turns the source images into texture containers (see texture_container.h), so the app can
+// upload them straight from disk instead of decoding PNG/JPEG on every launch.
+//
+// usage: texture_converter <image> [-rgba8|-r8|-bc1|-bc4|-bc5] [-mask] [-nomips]
+//  -mask keeps the coverage of a black and white blade mask the same at every mip level
+//  the container is written next to the image with TEXTURE_CONTAINER_EXTENSION in place of its extension
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "denis_types.h"
+#include "denis_math.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "texture_container.h"
+
+struct ConverterOptions
+{
+	char* imageFile;
+	TextureFormat format;
+	bool mask;
+	bool mipmaps;
+};
+
+// copies the 4x4 block starting at the given texel, blocks hanging off the edge repeat the last row/column
+static void getBlock(u8* pixels, s32 width, s32 height, s32 blockX, s32 blockY, u8 block[16*4])
+{
+	for (s32 y = 0; y < 4; ++y)
+	{
+		s32 sourceY = MIN(blockY + y, height-1);
+		for (s32 x = 0; x < 4; ++x)
+		{
+			s32 sourceX = MIN(blockX + x, width-1);
+			memcpy(&block[(y*4 + x)*4], &pixels[(sourceY*width + sourceX)*4], 4);
+		}
+	}
+}
+
+static inline u16 packRGB565(s32 r, s32 g, s32 b)
+{
+	return (u16)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+static inline void unpackRGB565(u16 colour, s32 rgb[3])
+{
+	rgb[0] = ((colour >> 11) & 0x1F)*255/31;
+	rgb[1] = ((colour >> 5) & 0x3F)*255/63;
+	rgb[2] = (colour & 0x1F)*255/31;
+}
+
+//NOTE(denis): uses the inset bounding box of the block's colours as the endpoints, which is nowhere near as good
+// as a real encoder but is fine for grass and doesn't need anything outside the repo
+static void encodeBC1Block(u8 block[16*4], u8* dest)
+{
+	s32 minColour[3] = {255, 255, 255};
+	s32 maxColour[3] = {0, 0, 0};
+	for (s32 i = 0; i < 16; ++i)
+	{
+		for (s32 channel = 0; channel < 3; ++channel)
+		{
+			minColour[channel] = MIN(minColour[channel], block[i*4 + channel]);
+			maxColour[channel] = MAX(maxColour[channel], block[i*4 + channel]);
+		}
+	}
+
+	for (s32 channel = 0; channel < 3; ++channel)
+	{
+		s32 inset = (maxColour[channel] - minColour[channel])/16;
+		minColour[channel] += inset;
+		maxColour[channel] -= inset;
+	}
+
+	u16 colour0 = packRGB565(maxColour[0], maxColour[1], maxColour[2]);
+	u16 colour1 = packRGB565(minColour[0], minColour[1], minColour[2]);
+	// colour0 has to be the larger one or the block is decoded in the 3 colour mode
+	if (colour0 < colour1)
+	{
+		u16 temp = colour0;
+		colour0 = colour1;
+		colour1 = temp;
+	}
+
+	u32 indices = 0;
+	if (colour0 != colour1)
+	{
+		s32 palette[4][3];
+		unpackRGB565(colour0, palette[0]);
+		unpackRGB565(colour1, palette[1]);
+		for (s32 channel = 0; channel < 3; ++channel)
+		{
+			palette[2][channel] = (2*palette[0][channel] + palette[1][channel])/3;
+			palette[3][channel] = (palette[0][channel] + 2*palette[1][channel])/3;
+		}
+
+		for (s32 i = 0; i < 16; ++i)
+		{
+			u32 bestIndex = 0;
+			s32 bestDistance = 0x7FFFFFFF;
+			for (u32 p = 0; p < 4; ++p)
+			{
+				s32 distance = 0;
+				for (s32 channel = 0; channel < 3; ++channel)
+				{
+					s32 diff = block[i*4 + channel] - palette[p][channel];
+					distance += diff*diff;
+				}
+
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+
+			indices |= bestIndex << (i*2);
+		}
+	}
+
+	dest[0] = (u8)(colour0 & 0xFF);
+	dest[1] = (u8)(colour0 >> 8);
+	dest[2] = (u8)(colour1 & 0xFF);
+	dest[3] = (u8)(colour1 >> 8);
+	memcpy(dest + 4, &indices, 4);
+}
+
+// encodes one channel of the block, channel is the byte offset inside each RGBA texel
+static void encodeBC4Block(u8 block[16*4], s32 channel, u8* dest)
+{
+	s32 minValue = 255;
+	s32 maxValue = 0;
+	for (s32 i = 0; i < 16; ++i)
+	{
+		minValue = MIN(minValue, block[i*4 + channel]);
+		maxValue = MAX(maxValue, block[i*4 + channel]);
+	}
+
+	// with value0 > value1 the block uses 6 interpolated values instead of reserving two for 0 and 255
+	u64 indices = 0;
+	if (maxValue != minValue)
+	{
+		s32 palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (s32 p = 2; p < 8; ++p)
+			palette[p] = ((8 - p)*maxValue + (p - 1)*minValue + 3)/7;
+
+		for (s32 i = 0; i < 16; ++i)
+		{
+			u64 bestIndex = 0;
+			s32 bestDistance = 256;
+			for (u32 p = 0; p < 8; ++p)
+			{
+				s32 distance = abs(block[i*4 + channel] - palette[p]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+
+			indices |= bestIndex << (i*3);
+		}
+	}
+
+	dest[0] = (u8)maxValue;
+	dest[1] = (u8)minValue;
+	for (s32 i = 0; i < 6; ++i)
+		dest[2 + i] = (u8)((indices >> (i*8)) & 0xFF);
+}
+
+// writes the level in the container's format, dest must hold getTextureLevelSize bytes
+static void encodeLevel(TextureFormat format, u8* pixels, s32 width, s32 height, u8* dest)
+{
+	if (format == TEXTURE_FORMAT_RGBA8)
+	{
+		memcpy(dest, pixels, width*height*4);
+		return;
+	}
+	else if (format == TEXTURE_FORMAT_R8)
+	{
+		for (s32 i = 0; i < width*height; ++i)
+			dest[i] = pixels[i*4];
+		return;
+	}
+
+	u8 block[16*4];
+	for (s32 blockY = 0; blockY < height; blockY += 4)
+	{
+		for (s32 blockX = 0; blockX < width; blockX += 4)
+		{
+			getBlock(pixels, width, height, blockX, blockY, block);
+
+			switch (format)
+			{
+				case TEXTURE_FORMAT_BC1:
+				{
+					encodeBC1Block(block, dest);
+					dest += 8;
+				} break;
+
+				case TEXTURE_FORMAT_BC4:
+				{
+					encodeBC4Block(block, 0, dest);
+					dest += 8;
+				} break;
+
+				case TEXTURE_FORMAT_BC5:
+				{
+					encodeBC4Block(block, 0, dest);
+					encodeBC4Block(block, 1, dest + 8);
+					dest += 16;
+				} break;
+
+				default: break;
+			}
+		}
+	}
+}
+
+static bool parseOptions(int argc, char** argv, ConverterOptions* options)
+{
+	*options = {};
+	options->format = TEXTURE_FORMAT_RGBA8;
+	options->mipmaps = true;
+
+	for (s32 i = 1; i < argc; ++i)
+	{
+		char* arg = argv[i];
+		if (strcmp(arg, "-rgba8") == 0)
+			options->format = TEXTURE_FORMAT_RGBA8;
+		else if (strcmp(arg, "-r8") == 0)
+			options->format = TEXTURE_FORMAT_R8;
+		else if (strcmp(arg, "-bc1") == 0)
+			options->format = TEXTURE_FORMAT_BC1;
+		else if (strcmp(arg, "-bc4") == 0)
+			options->format = TEXTURE_FORMAT_BC4;
+		else if (strcmp(arg, "-bc5") == 0)
+			options->format = TEXTURE_FORMAT_BC5;
+		else if (strcmp(arg, "-mask") == 0)
+			options->mask = true;
+		else if (strcmp(arg, "-nomips") == 0)
+			options->mipmaps = false;
+		else if (arg[0] != '-' && !options->imageFile)
+			options->imageFile = arg;
+		else
+			return false;
+	}
+
+	return options->imageFile != 0;
+}
+
+// swaps the image's extension for the container one, returns false if the name doesn't fit
+static bool getContainerFileName(char* imageFile, char* buffer, u32 bufferSize)
+{
+	u32 nameLength = (u32)strlen(imageFile);
+	u32 extensionStart = nameLength;
+	for (u32 i = 0; i < nameLength; ++i)
+	{
+		if (imageFile[i] == '.')
+			extensionStart = i;
+		else if (imageFile[i] == '/' || imageFile[i] == '\\')
+			extensionStart = nameLength;
+	}
+
+	if (extensionStart + sizeof(TEXTURE_CONTAINER_EXTENSION) > bufferSize)
+		return false;
+
+	memcpy(buffer, imageFile, extensionStart);
+	memcpy(buffer + extensionStart, TEXTURE_CONTAINER_EXTENSION, sizeof(TEXTURE_CONTAINER_EXTENSION));
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	ConverterOptions options;
+	if (!parseOptions(argc, argv, &options))
+	{
+		printf("usage: texture_converter <image> [-rgba8|-r8|-bc1|-bc4|-bc5] [-mask] [-nomips]\n");
+		return 1;
+	}
+
+	char containerFile[260];
+	if (!getContainerFileName(options.imageFile, containerFile, sizeof(containerFile)))
+	{
+		printf("image file name is too long: %s\n", options.imageFile);
+		return 1;
+	}
+
+	s32 width, height, numComponents;
+	u8* pixels = stbi_load(options.imageFile, &width, &height, &numComponents, 4);
+	if (!pixels)
+	{
+		printf("could not load %s: %s\n", options.imageFile, stbi_failure_reason());
+		return 1;
+	}
+
+	f32 coverage = options.mask ? getMaskCoverage(pixels, width, height, 4) : 0.0f;
+
+	// every level is kept in RGBA until it's encoded
+	u8* levelPixels[TEXTURE_MAX_LEVELS] = {};
+	TextureLevel levels[TEXTURE_MAX_LEVELS] = {};
+	u32 levelCount = 0;
+
+	levelPixels[0] = pixels;
+	levels[0].width = width;
+	levels[0].height = height;
+	levelCount = 1;
+
+	while (options.mipmaps && (levels[levelCount-1].width > 1 || levels[levelCount-1].height > 1) &&
+		   levelCount < TEXTURE_MAX_LEVELS)
+	{
+		TextureLevel* previous = &levels[levelCount-1];
+		TextureLevel* level = &levels[levelCount];
+		level->width = MAX(previous->width/2, 1);
+		level->height = MAX(previous->height/2, 1);
+
+		levelPixels[levelCount] = (u8*)malloc(level->width*level->height*4);
+		downsampleTexture(levelPixels[levelCount-1], previous->width, previous->height,
+						  levelPixels[levelCount], level->width, level->height, 4);
+		if (options.mask)
+			thresholdMaskLevel(levelPixels[levelCount], level->width, level->height, 4, coverage);
+
+		++levelCount;
+	}
+
+	u32 fileSize = sizeof(TextureContainerHeader) + levelCount*sizeof(TextureLevel);
+	for (u32 i = 0; i < levelCount; ++i)
+	{
+		levels[i].offset = fileSize;
+		levels[i].size = getTextureLevelSize(options.format, levels[i].width, levels[i].height);
+		fileSize += levels[i].size;
+	}
+
+	u8* fileData = (u8*)calloc(1, fileSize);
+
+	TextureContainerHeader* header = (TextureContainerHeader*)fileData;
+	header->magic = TEXTURE_CONTAINER_MAGIC;
+	header->version = TEXTURE_CONTAINER_VERSION;
+	header->format = options.format;
+	header->width = width;
+	header->height = height;
+	header->levelCount = levelCount;
+	memcpy(fileData + sizeof(TextureContainerHeader), levels, levelCount*sizeof(TextureLevel));
+
+	for (u32 i = 0; i < levelCount; ++i)
+		encodeLevel(options.format, levelPixels[i], levels[i].width, levels[i].height, fileData + levels[i].offset);
+
+	bool success = false;
+	FILE* file = fopen(containerFile, "wb");
+	if (file)
+	{
+		success = fwrite(fileData, 1, fileSize, file) == fileSize;
+		fclose(file);
+	}
+
+	if (success)
+		printf("%s -> %s (%u levels, %u bytes)\n", options.imageFile, containerFile, levelCount, fileSize);
+	else
+		printf("could not write %s\n", containerFile);
+
+	free(fileData);
+	for (u32 i = 1; i < levelCount; ++i)
+		free(levelPixels[i]);
+	stbi_image_free(pixels);
+
+	return success ? 0 : 1;
+}
@@ -7,6 +7,7 @@
 
 #include "Strsafe.h"
 #include "Windowsx.h"
+#include "Psapi.h"
 #include <gl/gl.h>
 
 #include "denis_types.h"
@@ -17,24 +18,42 @@
 #define PLATFORM_IMPLEMENTATION
 #include "platform_layer.h"
 
+#include "benchmark.h"
+#include "input_recording.h"
+#include "image_file.h"
+#include "frame_export.h"
+#include "frame_pacing.h"
+
 //NOTE(denis): Windows specific OpenGL stuff
 #define WGL_CONTEXT_MAJOR_VERSION_ARB 0x2091
 #define WGL_CONTEXT_MINOR_VERSION_ARB 0x2092
 #define WGL_CONTEXT_PROFILE_MASK_ARB 0x9126
 #define WGL_CONTEXT_CORE_PROFILE_BIT_ARB 0x00000001
 
-//NOTE(denis): this function is win32 specific
+//NOTE(denis): these functions are win32 specific
 typedef HGLRC(*GL_CREATE_CONTEXT_PTR)(HDC, HGLRC, int*);
+typedef BOOL(WINAPI *WGL_SWAP_INTERVAL_PTR)(int);
 
 #define INIT_GL_FUNCTION(type, name) name = (type)win32_loadGLFunction(#name);
+#define INIT_OPTIONAL_GL_FUNCTION(type, name) name = (type)win32_getGLProcAddress(#name);
 
 #define DEFAULT_WINDOW_WIDTH 640
 #define DEFAULT_WINDOW_HEIGHT 480
 
+// how much work each thread can have waiting in its own deque, must be a power of two
+#define WORK_QUEUE_SIZE 512
+#define MAX_WORKER_THREADS 63
+// a parallelFor is never split into more ranges than this, which also keeps it from filling a deque
+#define PARALLEL_FOR_MAX_BATCHES 128
+
 struct Memory;
 
 extern APP_UPDATE_CALL(appUpdate);
 extern APP_INIT_CALL(appInit);
+extern APP_SHUTDOWN_CALL(appShutdown);
+extern APP_RENDER_SOFTWARE_CALL(appRenderSoftware);
+extern APP_CHECK_REFERENCE_CALL(appCheckReference);
+extern APP_WRITE_REFERENCE_GOLDEN_CALL(appWriteReferenceGolden);
 
 static bool _running = true;
 static HDC _deviceContext;
@@ -46,6 +65,155 @@ static Input _input;
 
 static Platform _platform;
 
+struct Win32InputRecorder
+{
+	HANDLE file;
+
+	Input previousInput;
+	u32 framesRecorded;
+};
+
+struct Win32ExportJob
+{
+	// the mapped pixel pack buffer, RGBA8 with the bottom row first
+	u8* pixels;
+	s32 width;
+	s32 height;
+	ExportFormat format;
+
+	// big enough for the encoded file, 0 for raw frames since they're written straight out of the mapping
+	u8* fileBuffer;
+	u32 fileSize;
+	char fileName[MAX_PATH];
+
+	bool written;
+	volatile LONG finished;
+};
+
+struct Win32ExportSlot
+{
+	u32 pixelBuffer;
+	GLsync fence;
+
+	// the frame that was last read into the buffer, if it's still being read or encoded
+	bool reading;
+	bool encoding;
+	u32 frame;
+
+	Win32ExportJob job;
+};
+
+struct WorkQueueEntry
+{
+	WorkQueueCallback* callback;
+	void* data;
+	// optional
+	WorkCounter* counter;
+};
+
+struct WorkQueue;
+
+//NOTE(denis): a Chase-Lev deque. Only the thread that owns it pushes and pops, at the bottom, so that end needs no
+// interlocked ops except when taking the last entry. Every other thread steals from the top by claiming it with a
+// compare exchange. The indices only ever go up, an entry lives at index & (WORK_QUEUE_SIZE - 1)
+struct WorkDeque
+{
+	volatile LONG64 top;
+	volatile LONG64 bottom;
+
+	WorkQueueEntry entries[WORK_QUEUE_SIZE];
+
+	// so a worker thread knows which deque is its own
+	WorkQueue* queue;
+	u32 index;
+};
+
+// deque 0 belongs to the thread that made the queue, the rest belong to one worker thread each
+struct WorkQueue
+{
+	volatile LONG completionGoal;
+	volatile LONG completionCount;
+
+	HANDLE semaphore;
+
+	u32 dequeCount;
+	WorkDeque deques[MAX_WORKER_THREADS + 1];
+};
+
+// one parallelFor range, on the stack of the thread that's waiting for it
+struct Win32WorkRange
+{
+	WorkRangeCallback* callback;
+	void* data;
+	u32 first;
+	u32 onePastLast;
+};
+
+// set on each worker thread. Any other thread uses deque 0 of whichever queue it adds to, which is why only the
+// thread that made a queue can add to it from outside its work
+static __declspec(thread) WorkQueue* _threadWorkQueue;
+static __declspec(thread) u32 _threadDequeIndex;
+
+static WorkQueue _workQueue;
+// exported frames are encoded on their own queue, so the app's completeAllWork never waits on them
+static WorkQueue _exportQueue;
+
+static GL_CREATE_CONTEXT_PTR _wglCreateContextAttribsARB;
+static WGL_SWAP_INTERVAL_PTR _wglSwapIntervalEXT;
+static HGLRC _glContext;
+
+// returns a pointer to the character right after the flag, or 0 if the flag isn't in the command line
+static char* findCmdLineFlag(char* commandLine, char* flag)
+{
+	char* result = 0;
+
+	for (u32 i = 0; commandLine[i] != 0; ++i)
+	{
+		bool atTokenStart = i == 0 || commandLine[i-1] == ' ';
+		if (atTokenStart && stringStartsWith(commandLine + i, flag))
+		{
+			u32 flagLength = getStringSize(flag);
+			if (commandLine[i + flagLength] == 0 || commandLine[i + flagLength] == ' ')
+			{
+				result = commandLine + i + flagLength;
+				break;
+			}
+		}
+	}
+
+	return result;
+}
+
+// copies the token following the flag into argument and blanks both out of the command line so they
+// aren't mistaken for the force map name, returns false if the flag isn't there
+static bool takeCmdLineArgument(char* commandLine, char* flag, char* argument, u32 maxLength)
+{
+	char* flagEnd = findCmdLineFlag(commandLine, flag);
+	if (!flagEnd)
+		return false;
+
+	char* flagStart = flagEnd - getStringSize(flag);
+	for (char* c = flagStart; c < flagEnd; ++c)
+		*c = ' ';
+
+	char* token = flagEnd;
+	while (*token == ' ')
+		++token;
+
+	u32 length = 0;
+	while (token[length] != 0 && token[length] != ' ')
+	{
+		if (length < maxLength - 1)
+			argument[length] = token[length];
+
+		token[length] = ' ';
+		++length;
+	}
+	argument[MIN(length, maxLength - 1)] = 0;
+
+	return true;
+}
+
 //NOTE: the .ray file name must start with a letter
 bool getImageFromCmdLine(char* commandLine, char** imageFileName)
 {
@@ -78,11 +246,11 @@ bool getImageFromCmdLine(char* commandLine, char** imageFileName)
 				{
 					if (IS_LETTER(commandLine[i+4]) && !IS_LETTER(commandLine[i+5]))
 					{
-						(*imageFileName)[i+5] = 0;
+						commandLine[i+5] = 0;
 					}
 					else
 					{
-						(*imageFileName)[i+4] = 0;
+						commandLine[i+4] = 0;
 					}
 
 					success = true;
@@ -100,9 +268,14 @@ bool getImageFromCmdLine(char* commandLine, char** imageFileName)
 	return success;
 }
 
-static void* win32_readFile(char* fileName)
+//NOTE(denis): the data is always followed by a 0 byte so text files can be used as C strings,
+// dataSize can be 0 if the caller doesn't care about the size. The app always passes an arena, the platform
+// passes 0 for its own reads and gets heap memory it has to HEAP_FREE
+static void* win32_readFile(char* fileName, MemoryArena* arena, u64* dataSize)
 {
 	void* data = 0;
+	if (dataSize)
+		*dataSize = 0;
 	
 	HANDLE file = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
 
@@ -114,7 +287,11 @@ static void* win32_readFile(char* fileName)
 	if (GetFileSizeEx(file, &fileSize))
 	{
 		DWORD bytesRead = 0;
-		data = HEAP_ALLOC(fileSize.QuadPart);
+		if (arena)
+			data = tryPushSize(arena, fileSize.QuadPart + 1, 1);
+		else
+			data = HEAP_ALLOC(fileSize.QuadPart + 1);
+		
 		if (data)
 		{
 			//TODO(denis): using LowPart assumes that our files won't be larger than 2^32 bits
@@ -122,6 +299,10 @@ static void* win32_readFile(char* fileName)
 			{
 				//TODO(denis): error message
 			}
+			((u8*)data)[bytesRead] = 0;
+
+			if (dataSize)
+				*dataSize = bytesRead;
 		}
 		else
 		{
@@ -138,19 +319,426 @@ static void* win32_readFile(char* fileName)
 	return data;
 }
 
+static bool win32_writeFile(char* fileName, void* data, u32 dataSize)
+{
+	bool success = false;
+
+	HANDLE file = CreateFile(fileName, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD bytesWritten = 0;
+	if (WriteFile(file, data, dataSize, &bytesWritten, 0))
+	{
+		success = bytesWritten == dataSize;
+	}
+
+	CloseHandle(file);
+
+	return success;
+}
+
+static void* win32_openWriteFile(char* fileName)
+{
+	HANDLE file = CreateFile(fileName, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return 0;
+
+	return file;
+}
+
+//NOTE(denis): the handle isn't opened for overlapped IO, so the OVERLAPPED only carries the offset and the write
+// still finishes before this returns
+static bool win32_writeFileAt(void* file, u64 offset, void* data, u32 dataSize)
+{
+	OVERLAPPED position = {};
+	position.Offset = (DWORD)offset;
+	position.OffsetHigh = (DWORD)(offset >> 32);
+
+	DWORD bytesWritten = 0;
+	return WriteFile((HANDLE)file, data, dataSize, &bytesWritten, &position) && bytesWritten == dataSize;
+}
+
+static void win32_closeWriteFile(void* file)
+{
+	if (file)
+		CloseHandle((HANDLE)file);
+}
+
+//NOTE(denis): the file and mapping handles can be closed straight away, the view keeps the mapping alive until
+// it's unmapped
+static bool win32_mapFile(char* fileName, MappedFile* mappedFile)
+{
+	*mappedFile = {};
+
+	// writes aren't shared, so a view can't be of a file that's half way through being saved. If an editor has
+	// it open for writing this fails with a sharing violation and the caller tries again later (shader reloads do)
+	HANDLE file = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	// an empty file can't be mapped
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+	{
+		HANDLE mapping = CreateFileMapping(file, 0, PAGE_READONLY, 0, 0, 0);
+		if (mapping)
+		{
+			mappedFile->data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (mappedFile->data)
+				mappedFile->size = fileSize.QuadPart;
+
+			CloseHandle(mapping);
+		}
+	}
+
+	CloseHandle(file);
+
+	return mappedFile->data != 0;
+}
+
+static void win32_unmapFile(MappedFile* mappedFile)
+{
+	if (mappedFile->data)
+		UnmapViewOfFile(mappedFile->data);
+
+	*mappedFile = {};
+}
+
+static void win32_debugOutput(char* message)
+{
+	OutputDebugStringA(message);
+}
+
+// returns a handle for directoryChanged, or 0 if the directory can't be watched
+static void* win32_watchDirectory(char* directory)
+{
+	HANDLE watch = FindFirstChangeNotification(directory, FALSE,
+											   FILE_NOTIFY_CHANGE_LAST_WRITE|FILE_NOTIFY_CHANGE_FILE_NAME);
+	if (watch == INVALID_HANDLE_VALUE)
+		return 0;
+
+	return watch;
+}
+
+// true if anything in the watched directory was written, renamed, added or removed since the last call
+static bool win32_directoryChanged(void* watch)
+{
+	if (!watch)
+		return false;
+
+	bool changed = false;
+
+	// a single save can signal more than once, so we drain every pending notification here
+	while (WaitForSingleObject(watch, 0) == WAIT_OBJECT_0)
+	{
+		changed = true;
+		if (!FindNextChangeNotification(watch))
+			break;
+	}
+
+	return changed;
+}
+
+static void win32_unwatchDirectory(void* watch)
+{
+	if (watch)
+		FindCloseChangeNotification(watch);
+}
+
+static inline WorkDeque* win32_getThreadDeque(WorkQueue* queue)
+{
+	u32 index = _threadWorkQueue == queue ? _threadDequeIndex : 0;
+	return &queue->deques[index];
+}
+
+// only ever called by the deque's owner
+static void win32_pushWork(WorkDeque* deque, WorkQueueEntry entry)
+{
+	LONG64 bottom = deque->bottom;
+	ASSERT(bottom - deque->top < WORK_QUEUE_SIZE);
+
+	deque->entries[bottom & (WORK_QUEUE_SIZE - 1)] = entry;
+
+	// the entry has to be visible to the thieves before the bottom that hands it to them
+	MemoryBarrier();
+	deque->bottom = bottom + 1;
+}
+
+// only ever called by the deque's owner, takes the newest entry
+static bool win32_popWork(WorkDeque* deque, WorkQueueEntry* entry)
+{
+	LONG64 bottom = deque->bottom - 1;
+	deque->bottom = bottom;
+
+	// the thieves have to see the bottom entry is claimed before we look at how far they've got
+	MemoryBarrier();
+	LONG64 top = deque->top;
+
+	bool result = false;
+	if (top <= bottom)
+	{
+		*entry = deque->entries[bottom & (WORK_QUEUE_SIZE - 1)];
+		result = true;
+
+		if (top == bottom)
+		{
+			// the last entry, a thief could be taking it at the same time so it's claimed like they do
+			result = InterlockedCompareExchange64(&deque->top, top + 1, top) == top;
+			deque->bottom = top + 1;
+		}
+	}
+	else
+	{
+		deque->bottom = top;
+	}
+
+	return result;
+}
+
+// takes the oldest entry of someone else's deque. contended is set if there was an entry but another thread beat
+// us to it
+static bool win32_stealWork(WorkDeque* deque, WorkQueueEntry* entry, bool* contended)
+{
+	LONG64 top = deque->top;
+	MemoryBarrier();
+	LONG64 bottom = deque->bottom;
+
+	bool result = false;
+	if (top < bottom)
+	{
+		*entry = deque->entries[top & (WORK_QUEUE_SIZE - 1)];
+		result = InterlockedCompareExchange64(&deque->top, top + 1, top) == top;
+		if (!result)
+			*contended = true;
+	}
+
+	return result;
+}
+
+static void win32_addCountedWork(WorkQueue* queue, WorkCounter* counter, WorkQueueCallback* callback, void* data)
+{
+	// counted before it's pushed, so nothing can see it finish before it was added
+	if (counter)
+		InterlockedIncrement((volatile LONG*)&counter->pending);
+	InterlockedIncrement(&queue->completionGoal);
+
+	WorkQueueEntry entry;
+	entry.callback = callback;
+	entry.data = data;
+	entry.counter = counter;
+	win32_pushWork(win32_getThreadDeque(queue), entry);
+
+	ReleaseSemaphore(queue->semaphore, 1, 0);
+}
+
+static void win32_addWork(WorkQueue* queue, WorkQueueCallback* callback, void* data)
+{
+	win32_addCountedWork(queue, 0, callback, data);
+}
+
+// returns false if there was nothing in the queue
+static bool win32_doNextWork(WorkQueue* queue)
+{
+	WorkDeque* ownDeque = win32_getThreadDeque(queue);
+
+	WorkQueueEntry entry;
+	bool found = win32_popWork(ownDeque, &entry);
+
+	// every thread starts stealing from the one after it, so the thieves don't all pile onto the same deque
+	bool contended = false;
+	for (u32 i = 1; i < queue->dequeCount && !found; ++i)
+		found = win32_stealWork(&queue->deques[(ownDeque->index + i) % queue->dequeCount], &entry, &contended);
+
+	if (found)
+	{
+		entry.callback(entry.data);
+
+		if (entry.counter)
+			InterlockedDecrement((volatile LONG*)&entry.counter->pending);
+		InterlockedIncrement(&queue->completionCount);
+	}
+
+	return found || contended;
+}
+
+static void win32_completeAllWork(WorkQueue* queue)
+{
+	while (queue->completionCount != queue->completionGoal)
+	{
+		// once the queue is empty the last entries are still running on the workers, so we just spin on those
+		win32_doNextWork(queue);
+	}
+
+	queue->completionGoal = 0;
+	queue->completionCount = 0;
+}
+
+static void win32_waitForCounter(WorkQueue* queue, WorkCounter* counter)
+{
+	while (counter->pending != 0)
+	{
+		if (!win32_doNextWork(queue))
+			YieldProcessor();
+	}
+}
+
+static WORK_QUEUE_CALLBACK(win32_workRangeJob)
+{
+	Win32WorkRange* range = (Win32WorkRange*)data;
+	range->callback(range->data, range->first, range->onePastLast);
+}
+
+static void win32_parallelFor(WorkQueue* queue, u32 count, u32 minBatchSize, WorkRangeCallback* callback, void* data)
+{
+	if (count == 0)
+		return;
+
+	// a few ranges per thread, so a thread that gets a slow one doesn't hold the rest up
+	minBatchSize = MAX(minBatchSize, 1);
+	u32 batchCount = (count + minBatchSize - 1)/minBatchSize;
+	batchCount = MIN(batchCount, MIN(queue->dequeCount*4, (u32)PARALLEL_FOR_MAX_BATCHES));
+
+	// the first count % batchCount ranges get one more item than the rest
+	Win32WorkRange ranges[PARALLEL_FOR_MAX_BATCHES];
+	u32 first = 0;
+	for (u32 i = 0; i < batchCount; ++i)
+	{
+		Win32WorkRange* range = &ranges[i];
+		range->callback = callback;
+		range->data = data;
+		range->first = first;
+		range->onePastLast = first + count/batchCount + (i < count % batchCount ? 1 : 0);
+		first = range->onePastLast;
+	}
+
+	WorkCounter counter = {};
+	for (u32 i = 1; i < batchCount; ++i)
+		win32_addCountedWork(queue, &counter, win32_workRangeJob, &ranges[i]);
+
+	// the first range is done here rather than sitting idle while it waits
+	callback(data, ranges[0].first, ranges[0].onePastLast);
+
+	win32_waitForCounter(queue, &counter);
+}
+
+static DWORD WINAPI win32_workerThread(LPVOID parameter)
+{
+	WorkDeque* deque = (WorkDeque*)parameter;
+	WorkQueue* queue = deque->queue;
+
+	_threadWorkQueue = queue;
+	_threadDequeIndex = deque->index;
+
+	for (;;)
+	{
+		if (!win32_doNextWork(queue))
+			WaitForSingleObjectEx(queue->semaphore, INFINITE, FALSE);
+	}
+}
+
+// one worker per logical processor other than the one the main thread is on, up to maxWorkers
+static void win32_initWorkQueue(WorkQueue* queue, LONG maxWorkers = MAX_WORKER_THREADS)
+{
+	*queue = {};
+
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+
+	LONG workerCount = (LONG)MAX(systemInfo.dwNumberOfProcessors, 2) - 1;
+	workerCount = MIN(workerCount, MIN(maxWorkers, MAX_WORKER_THREADS));
+
+	queue->semaphore = CreateSemaphoreEx(0, 0, workerCount, 0, 0, SEMAPHORE_ALL_ACCESS);
+	queue->dequeCount = (u32)workerCount + 1;
+
+	for (u32 i = 0; i < queue->dequeCount; ++i)
+	{
+		queue->deques[i].queue = queue;
+		queue->deques[i].index = i;
+	}
+
+	for (u32 i = 1; i < queue->dequeCount; ++i)
+	{
+		HANDLE thread = CreateThread(0, 0, win32_workerThread, &queue->deques[i], 0, 0);
+		CloseHandle(thread);
+	}
+}
+
+static bool win32_beginInputRecording(Win32InputRecorder* recorder, char* fileName, char* forceMapFile)
+{
+	*recorder = {};
+
+	recorder->file = CreateFile(fileName, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if (recorder->file == INVALID_HANDLE_VALUE)
+	{
+		recorder->file = 0;
+		return false;
+	}
+
+	InputRecordingHeader header = {};
+	header.magic = INPUT_RECORDING_MAGIC;
+	header.version = INPUT_RECORDING_VERSION;
+	header.inputSize = sizeof(Input);
+	header.randomSeed = INPUT_RECORDING_RANDOM_SEED;
+	header.windowWidth = _windowWidth;
+	header.windowHeight = _windowHeight;
+	for (u32 i = 0; forceMapFile[i] != 0 && i < ARRAY_COUNT(header.forceMapFile) - 1; ++i)
+		header.forceMapFile[i] = forceMapFile[i];
+
+	DWORD bytesWritten;
+	WriteFile(recorder->file, &header, sizeof(header), &bytesWritten, 0);
+
+	return true;
+}
+
+static void win32_recordInputFrame(Win32InputRecorder* recorder, Input* input, f32 frameDelta)
+{
+	if (!recorder->file)
+		return;
+
+	u8 frameData[INPUT_FRAME_MAX_SIZE];
+	Input* previousInput = recorder->framesRecorded > 0 ? &recorder->previousInput : 0;
+	u32 frameSize = encodeInputFrame(frameData, input, previousInput, frameDelta);
+
+	DWORD bytesWritten;
+	WriteFile(recorder->file, frameData, frameSize, &bytesWritten, 0);
+
+	recorder->previousInput = *input;
+	++recorder->framesRecorded;
+}
+
+static void win32_endInputRecording(Win32InputRecorder* recorder)
+{
+	if (recorder->file)
+		CloseHandle(recorder->file);
+
+	*recorder = {};
+}
+
+// returns 0 if the driver doesn't have the function. Some drivers hand back 1, 2, 3 or -1 instead of 0 for
+// functions they don't have, so those are treated as missing too
+static void* win32_getGLProcAddress(char* functionName)
+{
+	void* function = (void*)wglGetProcAddress(functionName);
+
+	if (function == (void*)1 || function == (void*)2 || function == (void*)3 || function == (void*)-1)
+		function = 0;
+
+	return function;
+}
+
 static void* win32_loadGLFunction(char* functionName)
 {
-	void* function = 0;
-	function = wglGetProcAddress(functionName);
+	void* function = win32_getGLProcAddress(functionName);
 
 	// TODO(denis): wglGetProcAddress will fail if the function happens to be one of the functions included in the
 	//version of OpenGL shipped with Windows
 	
 	if (!function)
 	{
-		char* errorString = concatStrings(functionName, " could not be loaded.\n");
-		OutputDebugStringA(errorString);
-		HEAP_FREE(errorString);
+		OutputDebugStringA(functionName);
+		OutputDebugStringA(" could not be loaded.\n");
 		//TODO(denis): exiting the entire program might be a bit harsh?
 		exit(1);
 	}
@@ -158,6 +746,24 @@ static void* win32_loadGLFunction(char* functionName)
 	return function;
 }
 
+static HGLRC win32_createModernGLContext()
+{
+	int contextAttribs[] = {
+		WGL_CONTEXT_MAJOR_VERSION_ARB, 4,
+		WGL_CONTEXT_MINOR_VERSION_ARB, 0,
+		WGL_CONTEXT_PROFILE_MASK_ARB, WGL_CONTEXT_CORE_PROFILE_BIT_ARB,
+		0
+	};
+	HGLRC result = _wglCreateContextAttribsARB(_deviceContext, 0, contextAttribs);
+	if (!result)
+	{
+		OutputDebugStringA("Error creating modern OpenGL context\n");
+		exit(1);
+	}
+
+	return result;
+}
+
 static void win32_initOpenGL()
 {
 	// create a dummy context to use for loading modern OpenGL
@@ -194,21 +800,9 @@ static void win32_initOpenGL()
 	}
 
 	// now we load the extensions required to create a modern OpenGL context
-	GL_CREATE_CONTEXT_PTR wglCreateContextAttribsARB =
-		(GL_CREATE_CONTEXT_PTR)win32_loadGLFunction("wglCreateContextAttribsARB");;
+	_wglCreateContextAttribsARB = (GL_CREATE_CONTEXT_PTR)win32_loadGLFunction("wglCreateContextAttribsARB");
 
-	int contextAttribs[] = {
-		WGL_CONTEXT_MAJOR_VERSION_ARB, 4,
-		WGL_CONTEXT_MINOR_VERSION_ARB, 0,
-		WGL_CONTEXT_PROFILE_MASK_ARB, WGL_CONTEXT_CORE_PROFILE_BIT_ARB,
-		0
-	};
-	HGLRC modernGLContext = wglCreateContextAttribsARB(_deviceContext, 0, contextAttribs);
-	if (!modernGLContext)
-	{
-		OutputDebugStringA("Error creating modern OpenGL context\n");
-		exit(1);
-	}
+	HGLRC modernGLContext = win32_createModernGLContext();
 
 	wglMakeCurrent(NULL, NULL);
 	wglDeleteContext(glContext);
@@ -217,14 +811,31 @@ static void win32_initOpenGL()
 		OutputDebugStringA("Error making OpenGL 3.2 context current\n");
 		exit(1);
 	}
+
+	_glContext = modernGLContext;
 }
 
-LRESULT CALLBACK win32_messageCallback(HWND windowHandle, UINT message, WPARAM wParam, LPARAM lParam)
+//NOTE(denis): throws away every GL object the app created, the function pointers stay valid since
+// the pixel format and driver don't change
+static void win32_recreateOpenGLContext()
 {
-	LRESULT result = 0;
-	
-	switch(message)
-	{
+	wglMakeCurrent(NULL, NULL);
+	wglDeleteContext(_glContext);
+
+	_glContext = win32_createModernGLContext();
+	if (!wglMakeCurrent(_deviceContext, _glContext))
+	{
+		OutputDebugStringA("Error making OpenGL 3.2 context current\n");
+		exit(1);
+	}
+}
+
+LRESULT CALLBACK win32_messageCallback(HWND windowHandle, UINT message, WPARAM wParam, LPARAM lParam)
+{
+	LRESULT result = 0;
+	
+	switch(message)
+	{
 		case WM_DESTROY:
 		{
 			_running = false;
@@ -277,6 +888,14 @@ LRESULT CALLBACK win32_messageCallback(HWND windowHandle, UINT message, WPARAM w
 			{
 				_input.controller.actionPressed = true;
 			}
+			else if (wParam == VK_F9)
+			{
+				_input.controller.softwareRenderPressed = true;
+			}
+			else if (wParam == VK_F8)
+			{
+				_input.controller.posterPressed = true;
+			}
 		} break;
 
 		case WM_KEYUP:
@@ -303,6 +922,14 @@ LRESULT CALLBACK win32_messageCallback(HWND windowHandle, UINT message, WPARAM w
 			{
 				_input.controller.actionPressed = false;
 			}
+			else if (wParam == VK_F9)
+			{
+				_input.controller.softwareRenderPressed = false;
+			}
+			else if (wParam == VK_F8)
+			{
+				_input.controller.posterPressed = false;
+			}
 		} break;
 
 		case WM_MOUSEMOVE:
@@ -454,6 +1081,587 @@ LRESULT CALLBACK win32_messageCallback(HWND windowHandle, UINT message, WPARAM w
 	return result;
 }
 
+static f64 win32_getElapsedMs(LARGE_INTEGER start, LARGE_INTEGER end, LARGE_INTEGER countFrequency)
+{
+	u64 countsPassed = end.QuadPart - start.QuadPart;
+	return (f64)countsPassed * 1000.0 / (f64)countFrequency.QuadPart;
+}
+
+// sleeps until PACING_SPIN_MS before the frame is due and spins for the rest, so we don't oversleep the deadline
+// but don't burn a whole core waiting for it either. Without a fine scheduler period a sleep can overshoot by a
+// whole tick, so then we only spin
+static void win32_waitForFrameDeadline(LARGE_INTEGER frameStart, f64 framePeriodMs, LARGE_INTEGER countFrequency,
+									   bool fineSleep)
+{
+	LARGE_INTEGER currentCounts;
+	QueryPerformanceCounter(&currentCounts);
+	f64 remainingMs = framePeriodMs - win32_getElapsedMs(frameStart, currentCounts, countFrequency);
+
+	if (fineSleep && remainingMs > PACING_SPIN_MS)
+		Sleep((DWORD)(remainingMs - PACING_SPIN_MS));
+
+	while (remainingMs > 0.0)
+	{
+		QueryPerformanceCounter(&currentCounts);
+		remainingMs = framePeriodMs - win32_getElapsedMs(frameStart, currentCounts, countFrequency);
+	}
+}
+
+// runs every benchmark scenario offscreen at a fixed resolution and writes the results as JSON
+static void win32_runBenchmark(HWND windowHandle, u32 framesPerScenario)
+{
+	LARGE_INTEGER countFrequency;
+	QueryPerformanceFrequency(&countFrequency);
+
+	f64* cpuTimings = (f64*)HEAP_ALLOC(framesPerScenario*sizeof(f64));
+	f64* gpuTimings = (f64*)HEAP_ALLOC(framesPerScenario*sizeof(f64));
+	f64* frameTimings = (f64*)HEAP_ALLOC(framesPerScenario*sizeof(f64));
+
+	u32 numScenarios = getBenchmarkScenarioCount();
+	u32 reportSize = (u32)(BENCHMARK_REPORT_HEADER_SIZE + numScenarios*BENCHMARK_SCENARIO_REPORT_SIZE);
+	char* report = (char*)HEAP_ALLOC(reportSize);
+	u32 reportLength = 0;
+
+	//NOTE(denis): a report with a scenario missing (or half written) would be quietly wrong or not even valid
+	// JSON, so if anything doesn't fit nothing is written at all
+	bool reportComplete = true;
+	s32 headerLength = snprintf(report, reportSize,
+								"{\n\t\"frames\": %u,\n\t\"width\": %u,\n\t\"height\": %u,\n\t\"timestep\": %f,\n"
+								"\t\"scenarios\": [",
+								framesPerScenario, BENCHMARK_WIDTH, BENCHMARK_HEIGHT, BENCHMARK_TIMESTEP);
+	if (headerLength < 0 || (u32)headerLength >= reportSize)
+		reportComplete = false;
+	else
+		reportLength = (u32)headerLength;
+
+	for (u32 scenarioIndex = 0; scenarioIndex < numScenarios && _running && reportComplete; ++scenarioIndex)
+	{
+		BenchmarkScenario scenario = getBenchmarkScenario(scenarioIndex);
+
+		// every scenario starts from a fresh context and fresh memory so nothing carries over between them
+		win32_recreateOpenGLContext();
+		void* scenarioMemory = VirtualAlloc(0, APP_MEMORY_SIZE, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+
+		Framebuffer framebuffer = createFramebuffer(BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+		if (!framebuffer.id)
+		{
+			OutputDebugStringA("Could not create the benchmark framebuffer\n");
+			VirtualFree(scenarioMemory, 0, MEM_RELEASE);
+			break;
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.id);
+		glViewport(0, 0, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+
+		srand(BENCHMARK_RANDOM_SEED);
+		appInit(_platform, (Memory*)scenarioMemory, scenario.forceMapFile);
+
+		u32 timerQueries[BENCHMARK_QUERY_LATENCY];
+		glGenQueries(BENCHMARK_QUERY_LATENCY, timerQueries);
+
+		FrameStats frameStats = {};
+		u64 totalBladesSubmitted = 0;
+		u32 numMeasuredFrames = 0;
+		u32 numGPUTimings = 0;
+		u32 numFrameTimings = 0;
+		LARGE_INTEGER previousStartCounts = {};
+
+		u32 totalFrames = BENCHMARK_SETUP_FRAMES + framesPerScenario;
+		for (u32 frame = 0; frame < totalFrames && _running; ++frame)
+		{
+			MSG message;
+			while (PeekMessage(&message, windowHandle, 0, 0, PM_REMOVE))
+			{
+				if (message.message == WM_QUIT)
+					_running = false;
+
+				TranslateMessage(&message);
+				DispatchMessage(&message);
+			}
+
+			Input input;
+			getBenchmarkInput(&scenario, frame, &input);
+
+			glClearColor(TARGET_CLEAR_COLOUR);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			bool measured = frame >= BENCHMARK_SETUP_FRAMES;
+			if (measured)
+				glBeginQuery(GL_TIME_ELAPSED, timerQueries[numMeasuredFrames % BENCHMARK_QUERY_LATENCY]);
+
+			LARGE_INTEGER startCounts;
+			QueryPerformanceCounter(&startCounts);
+
+			frameStats = {};
+			appUpdate(_platform, (Memory*)scenarioMemory, &input, BENCHMARK_TIMESTEP, &frameStats);
+
+			LARGE_INTEGER endCounts;
+			QueryPerformanceCounter(&endCounts);
+
+			if (measured)
+			{
+				glEndQuery(GL_TIME_ELAPSED);
+
+				//NOTE(denis): appUpdate only submits the GPU's work, the driver blocks on it later once it has queued
+				// up too many frames. The time between the starts of two frames includes that, so it's what a whole
+				// frame costs when the CPU and GPU overlap the way they do in the interactive loop
+				if (numMeasuredFrames > 0)
+				{
+					frameTimings[numFrameTimings++] = win32_getElapsedMs(previousStartCounts, startCounts,
+																		 countFrequency);
+				}
+				previousStartCounts = startCounts;
+
+				cpuTimings[numMeasuredFrames] = win32_getElapsedMs(startCounts, endCounts, countFrequency);
+				totalBladesSubmitted += frameStats.bladesSubmitted;
+				++numMeasuredFrames;
+
+				// the query we are about to reuse next frame is the oldest one in flight
+				if (numMeasuredFrames >= BENCHMARK_QUERY_LATENCY)
+				{
+					u64 gpuNanoseconds = 0;
+					glGetQueryObjectui64v(timerQueries[numMeasuredFrames % BENCHMARK_QUERY_LATENCY],
+										  GL_QUERY_RESULT, &gpuNanoseconds);
+					gpuTimings[numGPUTimings++] = (f64)gpuNanoseconds / 1000000.0;
+				}
+			}
+		}
+
+		// collecting the queries that were still in flight when the scenario ended
+		while (numGPUTimings < numMeasuredFrames)
+		{
+			u64 gpuNanoseconds = 0;
+			glGetQueryObjectui64v(timerQueries[numGPUTimings % BENCHMARK_QUERY_LATENCY],
+								  GL_QUERY_RESULT, &gpuNanoseconds);
+			gpuTimings[numGPUTimings++] = (f64)gpuNanoseconds / 1000000.0;
+		}
+
+		glDeleteQueries(BENCHMARK_QUERY_LATENCY, timerQueries);
+
+		PROCESS_MEMORY_COUNTERS memoryCounters = {};
+		memoryCounters.cb = sizeof(memoryCounters);
+		GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters));
+
+		TimingSummary cpuSummary = summarizeTimings(cpuTimings, numMeasuredFrames);
+		TimingSummary gpuSummary = summarizeTimings(gpuTimings, numGPUTimings);
+		TimingSummary frameSummary = summarizeTimings(frameTimings, numFrameTimings);
+		f64 averageBladesSubmitted = numMeasuredFrames > 0 ? (f64)totalBladesSubmitted/(f64)numMeasuredFrames : 0.0;
+
+		u32 scenarioLength = writeScenarioReport(report + reportLength, reportSize - reportLength, &scenario,
+												 scenarioIndex == 0, cpuSummary, gpuSummary, frameSummary,
+												 averageBladesSubmitted,
+												 &frameStats, (u64)memoryCounters.WorkingSetSize);
+		if (scenarioLength)
+			reportLength += scenarioLength;
+		else
+			reportComplete = false;
+
+		char logBuffer[256];
+		StringCbPrintf(logBuffer, sizeof(logBuffer),
+					   "%s wind=%d %s: cpu (submission only) median %.3fms, gpu median %.3fms, "
+					   "frame median %.3fms\n",
+					   _cameraPathNames[scenario.cameraPath], scenario.windActive, scenario.forceMapFile,
+					   cpuSummary.median, gpuSummary.median, frameSummary.median);
+		OutputDebugStringA(logBuffer);
+
+		appShutdown(_platform, (Memory*)scenarioMemory);
+		VirtualFree(scenarioMemory, 0, MEM_RELEASE);
+	}
+
+	if (reportComplete)
+	{
+		s32 footerLength = snprintf(report + reportLength, reportSize - reportLength, "\n\t]\n}\n");
+		if (footerLength < 0 || (u32)footerLength >= reportSize - reportLength)
+			reportComplete = false;
+		else
+			reportLength += (u32)footerLength;
+	}
+
+	if (!reportComplete)
+		OutputDebugStringA("The benchmark results didn't fit in the report buffer, nothing was written\n");
+	else if (!win32_writeFile(BENCHMARK_OUTPUT_FILE, report, reportLength))
+		OutputDebugStringA("Could not write the benchmark results\n");
+
+	HEAP_FREE(report);
+	HEAP_FREE(frameTimings);
+	HEAP_FREE(gpuTimings);
+	HEAP_FREE(cpuTimings);
+}
+
+// plays a recording back as fast as possible into an offscreen framebuffer, for profiling
+static void win32_runHeadlessReplay(HWND windowHandle, InputPlayback* playback)
+{
+	LARGE_INTEGER countFrequency;
+	QueryPerformanceFrequency(&countFrequency);
+
+	Framebuffer framebuffer = createFramebuffer(playback->header.windowWidth, playback->header.windowHeight);
+	if (!framebuffer.id)
+	{
+		OutputDebugStringA("Could not create the replay framebuffer\n");
+		return;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.id);
+	glViewport(0, 0, framebuffer.width, framebuffer.height);
+
+	void* mainMemory = VirtualAlloc(0, APP_MEMORY_SIZE, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+
+	srand(playback->header.randomSeed);
+	appInit(_platform, (Memory*)mainMemory, playback->header.forceMapFile);
+
+	// one timing per frame, a frame record is never smaller than its flags and delta
+	u64 maxFrames = playback->dataSize / (sizeof(u8) + sizeof(f32));
+	f64* frameTimings = (f64*)HEAP_ALLOC(maxFrames*sizeof(f64));
+	u32 numFrames = 0;
+
+	LARGE_INTEGER replayStart;
+	QueryPerformanceCounter(&replayStart);
+
+	Input input;
+	f32 frameDelta;
+	while (_running && playNextInputFrame(playback, &input, &frameDelta))
+	{
+		MSG message;
+		while (PeekMessage(&message, windowHandle, 0, 0, PM_REMOVE))
+		{
+			if (message.message == WM_QUIT)
+				_running = false;
+
+			TranslateMessage(&message);
+			DispatchMessage(&message);
+		}
+
+		LARGE_INTEGER startCounts;
+		QueryPerformanceCounter(&startCounts);
+
+		glClearColor(TARGET_CLEAR_COLOUR);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		FrameStats frameStats = {};
+		appUpdate(_platform, (Memory*)mainMemory, &input, frameDelta, &frameStats);
+
+		// waiting for the GPU so each frame's time includes its rendering
+		glFinish();
+
+		LARGE_INTEGER endCounts;
+		QueryPerformanceCounter(&endCounts);
+		frameTimings[numFrames++] = win32_getElapsedMs(startCounts, endCounts, countFrequency);
+	}
+
+	LARGE_INTEGER replayEnd;
+	QueryPerformanceCounter(&replayEnd);
+
+	TimingSummary summary = summarizeTimings(frameTimings, numFrames);
+
+	char logBuffer[256];
+	StringCbPrintf(logBuffer, sizeof(logBuffer),
+				   "replayed %u frames in %.2fms: min %.3fms, median %.3fms, p99 %.3fms\n",
+				   numFrames, win32_getElapsedMs(replayStart, replayEnd, countFrequency),
+				   summary.min, summary.median, summary.p99);
+	OutputDebugStringA(logBuffer);
+
+	HEAP_FREE(frameTimings);
+	appShutdown(_platform, (Memory*)mainMemory);
+	VirtualFree(mainMemory, 0, MEM_RELEASE);
+}
+
+static WORK_QUEUE_CALLBACK(win32_exportFrameJob)
+{
+	Win32ExportJob* job = (Win32ExportJob*)data;
+
+	u8* file = job->fileBuffer;
+	if (job->format == EXPORT_FORMAT_PNG)
+		encodePNG(file, job->pixels, job->width, job->height);
+	else if (job->format == EXPORT_FORMAT_TGA)
+		encodeTGA(file, job->pixels, job->width, job->height);
+	else
+		file = job->pixels;
+
+	job->written = win32_writeFile(job->fileName, file, job->fileSize);
+
+	// everything the job did has to be visible before the main thread sees it finished and unmaps the pixels
+	MemoryBarrier();
+	job->finished = 1;
+}
+
+// maps a frame that was read back EXPORT_READBACK_LATENCY frames ago and hands it to a worker, returns false if
+// the frame couldn't be mapped
+static bool win32_beginFrameEncode(Win32ExportSlot* slot, char* directory)
+{
+	// the fence has had a couple of frames to pass, so this should hardly ever wait
+	while (glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, STREAM_BUFFER_WAIT_TIMEOUT) == GL_TIMEOUT_EXPIRED)
+	{
+	}
+	glDeleteSync(slot->fence);
+	slot->fence = 0;
+	slot->reading = false;
+
+	Win32ExportJob* job = &slot->job;
+	u32 pixelBytes = (u32)job->width*job->height*4;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pixelBuffer);
+	job->pixels = (u8*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixelBytes, GL_MAP_READ_BIT);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (!job->pixels)
+	{
+		OutputDebugStringA("Could not map an exported frame\n");
+		return false;
+	}
+
+	StringCbPrintf(job->fileName, sizeof(job->fileName), "%s\\frame_%05u.%s",
+				   directory, slot->frame, _exportFormatNames[job->format]);
+	job->written = false;
+	job->finished = 0;
+	slot->encoding = true;
+
+	win32_addWork(&_exportQueue, win32_exportFrameJob, job);
+
+	return true;
+}
+
+// waits for the slot's worker and unmaps its buffer, returns false if the frame wasn't written
+static bool win32_finishFrameEncode(Win32ExportSlot* slot)
+{
+	if (!slot->encoding)
+		return true;
+
+	// helping out with the queue rather than sitting idle, the job we want is usually one of the next few
+	while (!slot->job.finished)
+	{
+		win32_doNextWork(&_exportQueue);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pixelBuffer);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot->encoding = false;
+	slot->job.pixels = 0;
+
+	return slot->job.written;
+}
+
+// draws the first frame with the CPU rasterizer into outputFile. No window or GL context is made, so this runs on
+// machines without a GPU
+static bool win32_runSoftwareRender(char* outputFile, char* forceMapFile)
+{
+	void* mainMemory = VirtualAlloc(0, APP_MEMORY_SIZE, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+	if (!mainMemory)
+		return false;
+
+	// the blades you would get from starting the app normally
+	srand(INPUT_RECORDING_RANDOM_SEED);
+	bool succeeded = appRenderSoftware(_platform, (Memory*)mainMemory, forceMapFile, outputFile);
+
+	VirtualFree(mainMemory, 0, MEM_RELEASE);
+	return succeeded;
+}
+
+// compares the CPU reference with the golden case in goldenFile and with the GPU, returns false if they don't agree
+static bool win32_runReferenceCheck(char* goldenFile)
+{
+	void* mainMemory = VirtualAlloc(0, APP_MEMORY_SIZE, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+	if (!mainMemory)
+		return false;
+
+	bool passed = appCheckReference(_platform, (Memory*)mainMemory, goldenFile);
+	appShutdown(_platform, (Memory*)mainMemory);
+
+	VirtualFree(mainMemory, 0, MEM_RELEASE);
+	return passed;
+}
+
+// writes a new golden case from the CPU reference, without a window or GL context
+static bool win32_runReferenceUpdate(char* goldenFile)
+{
+	void* mainMemory = VirtualAlloc(0, APP_MEMORY_SIZE, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+	if (!mainMemory)
+		return false;
+
+	bool succeeded = appWriteReferenceGolden(_platform, (Memory*)mainMemory, goldenFile);
+
+	VirtualFree(mainMemory, 0, MEM_RELEASE);
+	return succeeded;
+}
+
+// renders a camera sequence offscreen and writes every frame into the directory. The sequence is the recording when
+// there is one, otherwise a turntable of turntableFrames frames
+static void win32_runExport(HWND windowHandle, char* directory, ExportFormat format, InputPlayback* playback,
+							char* forceMapFile, u32 turntableFrames)
+{
+	LARGE_INTEGER countFrequency;
+	QueryPerformanceFrequency(&countFrequency);
+
+	s32 width = playback ? (s32)playback->header.windowWidth : EXPORT_WIDTH;
+	s32 height = playback ? (s32)playback->header.windowHeight : EXPORT_HEIGHT;
+
+	u64 fileSize = getExportFileSize(format, width, height);
+	if (fileSize == 0)
+	{
+		OutputDebugStringA("The exported frames are too big for the format\n");
+		return;
+	}
+
+	// it's fine if the directory is already there, writing the first frame will catch any other problem
+	CreateDirectory(directory, 0);
+
+	Framebuffer framebuffer = createFramebuffer(width, height);
+	if (!framebuffer.id)
+	{
+		OutputDebugStringA("Could not create the export framebuffer\n");
+		return;
+	}
+
+	win32_initWorkQueue(&_exportQueue, EXPORT_WORKER_THREADS);
+
+	u32 pixelBytes = (u32)width*height*4;
+
+	Win32ExportSlot slots[EXPORT_READBACK_BUFFERS] = {};
+	for (u32 i = 0; i < EXPORT_READBACK_BUFFERS; ++i)
+	{
+		Win32ExportSlot* slot = &slots[i];
+
+		glGenBuffers(1, &slot->pixelBuffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pixelBuffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, pixelBytes, 0, GL_STREAM_READ);
+
+		slot->job.width = width;
+		slot->job.height = height;
+		slot->job.format = format;
+		slot->job.fileSize = (u32)fileSize;
+		if (format != EXPORT_FORMAT_RAW)
+			slot->job.fileBuffer = (u8*)HEAP_ALLOC(fileSize);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	void* mainMemory = VirtualAlloc(0, APP_MEMORY_SIZE, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+
+	srand(playback ? playback->header.randomSeed : EXPORT_RANDOM_SEED);
+	appInit(_platform, (Memory*)mainMemory, forceMapFile);
+
+	LARGE_INTEGER exportStart;
+	QueryPerformanceCounter(&exportStart);
+
+	//NOTE(denis): the app draws a frame behind its input, so the first update's frame is thrown away and the
+	// sequence ends with one more update (holding the last input) that draws the last frame
+	Input input = {};
+	f32 frameDelta = EXPORT_TIMESTEP;
+	u32 numUpdates = 0;
+
+	u32 numFrames = 0;
+	u32 numFailed = 0;
+	while (_running)
+	{
+		MSG message;
+		while (PeekMessage(&message, windowHandle, 0, 0, PM_REMOVE))
+		{
+			if (message.message == WM_QUIT)
+				_running = false;
+
+			TranslateMessage(&message);
+			DispatchMessage(&message);
+		}
+
+		bool lastUpdate = false;
+		if (playback)
+		{
+			Input playedInput;
+			f32 playedDelta;
+			if (playNextInputFrame(playback, &playedInput, &playedDelta))
+			{
+				input = playedInput;
+				frameDelta = playedDelta;
+			}
+			else
+			{
+				lastUpdate = true;
+			}
+		}
+		else
+		{
+			if (numUpdates == turntableFrames)
+				lastUpdate = true;
+			else
+				getTurntableInput(numUpdates, turntableFrames, &input);
+		}
+
+		// nothing was ever drawn
+		if (lastUpdate && numUpdates == 0)
+			break;
+
+		// the app reads back whatever framebuffer is bound as the target for its frame
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.id);
+		glViewport(0, 0, width, height);
+
+		glClearColor(TARGET_CLEAR_COLOUR);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		FrameStats frameStats = {};
+		appUpdate(_platform, (Memory*)mainMemory, &input, frameDelta, &frameStats);
+
+		if (numUpdates++ == 0)
+			continue;
+
+		Win32ExportSlot* slot = &slots[numFrames % EXPORT_READBACK_BUFFERS];
+		if (!win32_finishFrameEncode(slot))
+			++numFailed;
+
+		// with a pack buffer bound glReadPixels only queues the copy, it doesn't wait for the frame to finish
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.id);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pixelBuffer);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot->reading = true;
+		slot->frame = numFrames;
+		++numFrames;
+
+		if (numFrames > EXPORT_READBACK_LATENCY)
+		{
+			Win32ExportSlot* readySlot = &slots[(numFrames - 1 - EXPORT_READBACK_LATENCY) % EXPORT_READBACK_BUFFERS];
+			if (!win32_beginFrameEncode(readySlot, directory))
+				++numFailed;
+		}
+
+		if (lastUpdate)
+			break;
+	}
+
+	// the last few frames are still waiting to be mapped, oldest first so they're written in order
+	for (u32 i = 0; i < EXPORT_READBACK_BUFFERS; ++i)
+	{
+		Win32ExportSlot* slot = &slots[(numFrames + i) % EXPORT_READBACK_BUFFERS];
+		if (slot->reading && !win32_beginFrameEncode(slot, directory))
+			++numFailed;
+	}
+
+	win32_completeAllWork(&_exportQueue);
+
+	for (u32 i = 0; i < EXPORT_READBACK_BUFFERS; ++i)
+	{
+		Win32ExportSlot* slot = &slots[i];
+		if (!win32_finishFrameEncode(slot))
+			++numFailed;
+
+		glDeleteBuffers(1, &slot->pixelBuffer);
+		if (slot->job.fileBuffer)
+			HEAP_FREE(slot->job.fileBuffer);
+	}
+
+	LARGE_INTEGER exportEnd;
+	QueryPerformanceCounter(&exportEnd);
+
+	char logBuffer[256];
+	StringCbPrintf(logBuffer, sizeof(logBuffer), "exported %u frames to %s in %.2fms, %u could not be written\n",
+				   numFrames, directory, win32_getElapsedMs(exportStart, exportEnd, countFrequency), numFailed);
+	OutputDebugStringA(logBuffer);
+
+	deleteFramebuffer(&framebuffer);
+	appShutdown(_platform, (Memory*)mainMemory);
+	VirtualFree(mainMemory, 0, MEM_RELEASE);
+}
+
 int CALLBACK WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, int cmdShow)
 {
 	_windowWidth = DEFAULT_WINDOW_WIDTH;
@@ -467,14 +1675,128 @@ int CALLBACK WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine,
 	windowClass.hCursor = LoadCursor(0, IDC_ARROW);
 	windowClass.lpszClassName = "win32WindowClass";
 
+	//NOTE(denis): flags have to be read before the image name since getImageFromCmdLine modifies the string
+	bool benchmarkMode = false;
+	u32 benchmarkFrames = BENCHMARK_DEFAULT_FRAMES;
+	char* benchmarkArgs = findCmdLineFlag(cmdLine, "-benchmark");
+	if (benchmarkArgs)
+	{
+		benchmarkMode = true;
+
+		u32 requestedFrames = parseU32String(trimString(benchmarkArgs));
+		if (requestedFrames > 0)
+			benchmarkFrames = requestedFrames;
+	}
+
+	char recordFile[MAX_PATH] = {};
+	char replayFile[MAX_PATH] = {};
+	bool recording = takeCmdLineArgument(cmdLine, "-record", recordFile, MAX_PATH) && recordFile[0] != 0;
+	bool replaying = takeCmdLineArgument(cmdLine, "-replay", replayFile, MAX_PATH) && replayFile[0] != 0;
+	bool headless = findCmdLineFlag(cmdLine, "-headless") != 0;
+
+	PresentMode presentMode = PRESENT_TARGET_RATE;
+	u32 targetFrameRate = DEFAULT_TARGET_FRAME_RATE;
+	char presentModeName[16] = {};
+	if (takeCmdLineArgument(cmdLine, "-present", presentModeName, ARRAY_COUNT(presentModeName)) &&
+		!parsePresentMode(presentModeName, &presentMode, &targetFrameRate))
+	{
+		OutputDebugStringA("Unknown present mode, the modes are vsync, uncapped or a frame rate\n");
+		return 1;
+	}
+
+	char exportDirectory[MAX_PATH] = {};
+	char exportFormatName[16] = {};
+	char exportFramesArg[16] = {};
+	bool exporting = takeCmdLineArgument(cmdLine, "-export", exportDirectory, MAX_PATH) && exportDirectory[0] != 0;
+	ExportFormat exportFormat = EXPORT_FORMAT_PNG;
+	if (takeCmdLineArgument(cmdLine, "-format", exportFormatName, ARRAY_COUNT(exportFormatName)))
+	{
+		exportFormat = getExportFormat(exportFormatName);
+		if (exportFormat == EXPORT_FORMAT_COUNT)
+		{
+			OutputDebugStringA("Unknown export format, the formats are png, tga and raw\n");
+			return 1;
+		}
+	}
+	u32 exportFrames = EXPORT_DEFAULT_FRAMES;
+	if (takeCmdLineArgument(cmdLine, "-frames", exportFramesArg, ARRAY_COUNT(exportFramesArg)))
+	{
+		u32 requestedFrames = parseU32String(exportFramesArg);
+		if (requestedFrames > 0)
+			exportFrames = requestedFrames;
+	}
+
+	char softwareFile[MAX_PATH] = {};
+	bool softwareRendering = takeCmdLineArgument(cmdLine, "-software", softwareFile, MAX_PATH) &&
+		softwareFile[0] != 0;
+
+	char referenceCheckFile[MAX_PATH] = {};
+	char referenceUpdateFile[MAX_PATH] = {};
+	bool checkingReference = takeCmdLineArgument(cmdLine, "-reference-check", referenceCheckFile, MAX_PATH) &&
+		referenceCheckFile[0] != 0;
+	bool updatingReference = takeCmdLineArgument(cmdLine, "-reference-update", referenceUpdateFile, MAX_PATH) &&
+		referenceUpdateFile[0] != 0;
+
 	char* forceMapFile = 0;
-	if (cmdLine[0] != 0)
+	if (cmdLine[0] != 0 && !benchmarkMode)
 	{
 	    getImageFromCmdLine(cmdLine, &forceMapFile);
 	}
 
 	if (!forceMapFile)
 		forceMapFile = "default_force_map.png";
+
+	//NOTE(denis): nothing here needs GL, so it's set up before the window in case we never make one
+	_platform.readFile = win32_readFile;
+	_platform.writeFile = win32_writeFile;
+	_platform.openWriteFile = win32_openWriteFile;
+	_platform.writeFileAt = win32_writeFileAt;
+	_platform.closeWriteFile = win32_closeWriteFile;
+	_platform.mapFile = win32_mapFile;
+	_platform.unmapFile = win32_unmapFile;
+	_platform.debugOutput = win32_debugOutput;
+	_platform.watchDirectory = win32_watchDirectory;
+	_platform.directoryChanged = win32_directoryChanged;
+	_platform.unwatchDirectory = win32_unwatchDirectory;
+
+	win32_initWorkQueue(&_workQueue);
+	_platform.workQueue = &_workQueue;
+	_platform.addWork = win32_addWork;
+	_platform.completeAllWork = win32_completeAllWork;
+	_platform.addCountedWork = win32_addCountedWork;
+	_platform.waitForCounter = win32_waitForCounter;
+	_platform.parallelFor = win32_parallelFor;
+
+	if (softwareRendering)
+		return win32_runSoftwareRender(softwareFile, forceMapFile) ? 0 : 1;
+
+	if (updatingReference)
+		return win32_runReferenceUpdate(referenceUpdateFile) ? 0 : 1;
+
+	InputPlayback playback = {};
+	void* replayData = 0;
+	if (replaying)
+	{
+		u64 replayDataSize;
+		replayData = win32_readFile(replayFile, 0, &replayDataSize);
+		if (!beginInputPlayback(&playback, replayData, replayDataSize))
+		{
+			OutputDebugStringA("Could not read the input recording\n");
+			return 1;
+		}
+
+		// the recording decides everything that affects what gets drawn
+		playback.header.forceMapFile[ARRAY_COUNT(playback.header.forceMapFile) - 1] = 0;
+		forceMapFile = playback.header.forceMapFile;
+		_windowWidth = playback.header.windowWidth;
+		_windowHeight = playback.header.windowHeight;
+
+		recording = false;
+	}
+	else
+	{
+		headless = false;
+	}
 	
 	if (!RegisterClassEx(&windowClass))
 	{
@@ -482,7 +1804,9 @@ int CALLBACK WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine,
 		return 1;
 	}
 
-	DWORD windowStyles = WS_OVERLAPPEDWINDOW|WS_VISIBLE;
+	// the benchmark, export and reference check render offscreen, we only need the window for its GL context
+	bool offscreen = benchmarkMode || headless || exporting || checkingReference;
+	DWORD windowStyles = offscreen ? WS_OVERLAPPEDWINDOW : WS_OVERLAPPEDWINDOW|WS_VISIBLE;
 
 	RECT windowRect = {0, 0, (LONG)_windowWidth, (LONG)_windowHeight};
 	AdjustWindowRectEx(&windowRect, WS_OVERLAPPEDWINDOW, FALSE, 0);
@@ -529,14 +1853,119 @@ int CALLBACK WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine,
 	INIT_GL_FUNCTION(GL_UNIFORM_2IV_PTR, glUniform2iv);
 	INIT_GL_FUNCTION(GL_UNIFORM_2FV_PTR, glUniform2fv);
 	INIT_GL_FUNCTION(GL_UNIFORM_3FV_PTR, glUniform3fv);
+	INIT_GL_FUNCTION(GL_UNIFORM_1IV_PTR, glUniform1iv);
+	INIT_GL_FUNCTION(GL_UNIFORM_1FV_PTR, glUniform1fv);
 	INIT_GL_FUNCTION(GL_UNIFORM_MATRIX4FV_PTR, glUniformMatrix4fv);
 	INIT_GL_FUNCTION(GL_PATCH_PARAMETERI_PTR, glPatchParameteri);
 	INIT_GL_FUNCTION(GL_ACTIVE_TEXTURE_PTR, glActiveTexture);
+	INIT_GL_FUNCTION(GL_GEN_FRAMEBUFFERS_PTR, glGenFramebuffers);
+	INIT_GL_FUNCTION(GL_DELETE_FRAMEBUFFERS_PTR, glDeleteFramebuffers);
+	INIT_GL_FUNCTION(GL_BIND_FRAMEBUFFER_PTR, glBindFramebuffer);
+	INIT_GL_FUNCTION(GL_CHECK_FRAMEBUFFER_STATUS_PTR, glCheckFramebufferStatus);
+	INIT_GL_FUNCTION(GL_FRAMEBUFFER_RENDERBUFFER_PTR, glFramebufferRenderbuffer);
+	INIT_GL_FUNCTION(GL_GEN_RENDERBUFFERS_PTR, glGenRenderbuffers);
+	INIT_GL_FUNCTION(GL_DELETE_RENDERBUFFERS_PTR, glDeleteRenderbuffers);
+	INIT_GL_FUNCTION(GL_BIND_RENDERBUFFER_PTR, glBindRenderbuffer);
+	INIT_GL_FUNCTION(GL_RENDERBUFFER_STORAGE_PTR, glRenderbufferStorage);
+	INIT_GL_FUNCTION(GL_RENDERBUFFER_STORAGE_MULTISAMPLE_PTR, glRenderbufferStorageMultisample);
+	INIT_GL_FUNCTION(GL_BLIT_FRAMEBUFFER_PTR, glBlitFramebuffer);
+	INIT_GL_FUNCTION(GL_GEN_QUERIES_PTR, glGenQueries);
+	INIT_GL_FUNCTION(GL_DELETE_QUERIES_PTR, glDeleteQueries);
+	INIT_GL_FUNCTION(GL_BEGIN_QUERY_PTR, glBeginQuery);
+	INIT_GL_FUNCTION(GL_END_QUERY_PTR, glEndQuery);
+	INIT_GL_FUNCTION(GL_GET_QUERY_OBJECT_UI64V_PTR, glGetQueryObjectui64v);
+	INIT_GL_FUNCTION(GL_GET_PROGRAM_IV_PTR, glGetProgramiv);
+	INIT_GL_FUNCTION(GL_GET_PROGRAM_INFO_LOG_PTR, glGetProgramInfoLog);
+	INIT_GL_FUNCTION(GL_DELETE_PROGRAM_PTR, glDeleteProgram);
+	INIT_GL_FUNCTION(GL_GENERATE_MIPMAP_PTR, glGenerateMipmap);
+	INIT_GL_FUNCTION(GL_COMPRESSED_TEX_IMAGE_2D_PTR, glCompressedTexImage2D);
+	INIT_GL_FUNCTION(GL_TEX_IMAGE_3D_PTR, glTexImage3D);
+	INIT_GL_FUNCTION(GL_TEX_SUB_IMAGE_3D_PTR, glTexSubImage3D);
+	INIT_GL_FUNCTION(GL_COMPRESSED_TEX_IMAGE_3D_PTR, glCompressedTexImage3D);
+	INIT_GL_FUNCTION(GL_COMPRESSED_TEX_SUB_IMAGE_3D_PTR, glCompressedTexSubImage3D);
+	INIT_GL_FUNCTION(GL_MAP_BUFFER_RANGE_PTR, glMapBufferRange);
+	INIT_GL_FUNCTION(GL_COPY_BUFFER_SUB_DATA_PTR, glCopyBufferSubData);
+	INIT_GL_FUNCTION(GL_FENCE_SYNC_PTR, glFenceSync);
+	INIT_GL_FUNCTION(GL_CLIENT_WAIT_SYNC_PTR, glClientWaitSync);
+	INIT_GL_FUNCTION(GL_DELETE_SYNC_PTR, glDeleteSync);
+	INIT_GL_FUNCTION(GL_UNMAP_BUFFER_PTR, glUnmapBuffer);
+	INIT_GL_FUNCTION(GL_DELETE_BUFFERS_PTR, glDeleteBuffers);
+	INIT_GL_FUNCTION(GL_TRANSFORM_FEEDBACK_VARYINGS_PTR, glTransformFeedbackVaryings);
+	INIT_GL_FUNCTION(GL_BIND_BUFFER_BASE_PTR, glBindBufferBase);
+	INIT_GL_FUNCTION(GL_BEGIN_TRANSFORM_FEEDBACK_PTR, glBeginTransformFeedback);
+	INIT_GL_FUNCTION(GL_END_TRANSFORM_FEEDBACK_PTR, glEndTransformFeedback);
+
+	//NOTE(denis): program binaries are core in 4.1, we only ask for a 4.0 context so the cache is used when we get them
+	INIT_OPTIONAL_GL_FUNCTION(GL_GET_PROGRAM_BINARY_PTR, glGetProgramBinary);
+	INIT_OPTIONAL_GL_FUNCTION(GL_PROGRAM_BINARY_PTR, glProgramBinary);
+	INIT_OPTIONAL_GL_FUNCTION(GL_PROGRAM_PARAMETERI_PTR, glProgramParameteri);
+	// persistent mapping is core in 4.4, without it streamed blades are uploaded with glBufferSubData
+	INIT_OPTIONAL_GL_FUNCTION(GL_BUFFER_STORAGE_PTR, glBufferStorage);
+	INIT_GL_FUNCTION(GL_GET_STRINGI_PTR, glGetStringi);
+
+	glMaxShaderCompilerThreads =
+		(GL_MAX_SHADER_COMPILER_THREADS_PTR)win32_getGLProcAddress("glMaxShaderCompilerThreadsARB");
+	if (!glMaxShaderCompilerThreads)
+	{
+		glMaxShaderCompilerThreads =
+			(GL_MAX_SHADER_COMPILER_THREADS_PTR)win32_getGLProcAddress("glMaxShaderCompilerThreadsKHR");
+	}
+
+	if (checkingReference)
+	{
+		bool passed = win32_runReferenceCheck(referenceCheckFile);
+		DestroyWindow(windowHandle);
+		return passed ? 0 : 1;
+	}
+
+	if (benchmarkMode)
+	{
+		win32_runBenchmark(windowHandle, benchmarkFrames);
+		DestroyWindow(windowHandle);
+		return 0;
+	}
+
+	if (exporting)
+	{
+		win32_runExport(windowHandle, exportDirectory, exportFormat, replaying ? &playback : 0, forceMapFile,
+						exportFrames);
+		if (replayData)
+			HEAP_FREE(replayData);
+		DestroyWindow(windowHandle);
+		return 0;
+	}
+
+	if (headless)
+	{
+		win32_runHeadlessReplay(windowHandle, &playback);
+		HEAP_FREE(replayData);
+		DestroyWindow(windowHandle);
+		return 0;
+	}
 	
 	glViewport(0, 0, _windowWidth, _windowHeight);
-	
+
+	// 0 and 1 both mean the display's default rate
+	u32 refreshRate = (u32)GetDeviceCaps(_deviceContext, VREFRESH);
+	if (refreshRate <= 1)
+		refreshRate = DEFAULT_REFRESH_RATE;
+
+	_wglSwapIntervalEXT = (WGL_SWAP_INTERVAL_PTR)win32_getGLProcAddress("wglSwapIntervalEXT");
+	if (!_wglSwapIntervalEXT && presentMode == PRESENT_VSYNC)
+	{
+		OutputDebugStringA("The driver can't turn vsync on, targeting the refresh rate instead\n");
+		presentMode = PRESENT_TARGET_RATE;
+		targetFrameRate = refreshRate;
+	}
+	//NOTE(denis): the driver's default swap interval is up to the user's settings, so it's always set either way
+	if (_wglSwapIntervalEXT)
+		_wglSwapIntervalEXT(presentMode == PRESENT_VSYNC ? 1 : 0);
+
+	FramePacing pacing = createFramePacing(presentMode, presentMode == PRESENT_VSYNC ? refreshRate : targetFrameRate);
+	bool fineSleep = presentMode == PRESENT_TARGET_RATE && timeBeginPeriod(1) == TIMERR_NOERROR;
+
 	//TODO(denis): should probably let the user set the size of this
-	void* mainMemory = VirtualAlloc(0, MEGABYTE(256), MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+	void* mainMemory = VirtualAlloc(0, APP_MEMORY_SIZE, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
 	
 	LARGE_INTEGER countFrequency;
 	QueryPerformanceFrequency(&countFrequency); //NOTE(denis): counts/second
@@ -548,10 +1977,22 @@ int CALLBACK WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine,
 	_input.mouse.leftClickStartPos = V2(-1, -1);
 	_input.mouse.rightClickStartPos = V2(-1, -1);
 
-	_platform.readFile = win32_readFile;
-	
+	Win32InputRecorder recorder = {};
+	if (recording)
+	{
+		if (win32_beginInputRecording(&recorder, recordFile, forceMapFile))
+			srand(INPUT_RECORDING_RANDOM_SEED);
+		else
+			OutputDebugStringA("Could not create the input recording file\n");
+	}
+	else if (replaying)
+	{
+		srand(playback.header.randomSeed);
+	}
+
 	appInit(_platform, (Memory*)mainMemory, forceMapFile);
 
+	f32 lastFrameDelta = 1.0f/60.0f;
 	while (_running)
 	{
 		MSG message;
@@ -565,33 +2006,52 @@ int CALLBACK WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine,
 			DispatchMessage(&message);
 		}
 
-		glClearColor(0.4f, 0.5f, 0.7f, 1.0f);
+		glClearColor(TARGET_CLEAR_COLOUR);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		appUpdate(_platform, (Memory*)mainMemory, &_input);
+		Input* frameInput = &_input;
+		f32 frameDelta = lastFrameDelta;
+		Input replayInput;
+		if (replaying)
+		{
+			if (!playNextInputFrame(&playback, &replayInput, &frameDelta))
+				break;
+
+			frameInput = &replayInput;
+		}
+		else if (recording)
+		{
+			win32_recordInputFrame(&recorder, &_input, lastFrameDelta);
+		}
+
+		FrameStats frameStats = {};
+		appUpdate(_platform, (Memory*)mainMemory, frameInput, frameDelta, &frameStats);
+
+		LARGE_INTEGER workEndCounts;
+		QueryPerformanceCounter(&workEndCounts);
 
 		SwapBuffers(_deviceContext);
 
+		LARGE_INTEGER presentEndCounts;
+		QueryPerformanceCounter(&presentEndCounts);
+
+		if (pacing.mode == PRESENT_TARGET_RATE)
+			win32_waitForFrameDeadline(lastCounts, pacing.framePeriodMs, countFrequency, fineSleep);
+
 		LARGE_INTEGER currentCounts;
 		QueryPerformanceCounter(&currentCounts);
-		u64 timePassed = currentCounts.QuadPart - lastCounts.QuadPart;
-		f64 timeMs = (f64)timePassed * 1000.0 / (f64)countFrequency.QuadPart;
+		f64 timeMs = win32_getElapsedMs(lastCounts, currentCounts, countFrequency);
+
+		recordPacedFrame(&pacing, win32_getElapsedMs(lastCounts, workEndCounts, countFrequency),
+						 win32_getElapsedMs(workEndCounts, presentEndCounts, countFrequency),
+						 win32_getElapsedMs(presentEndCounts, currentCounts, countFrequency), timeMs);
+
+		char pacingReport[256];
+		if (reportFramePacing(&pacing, pacingReport, sizeof(pacingReport)))
+			OutputDebugStringA(pacingReport);
 
-		//TODO(denis): probably don't do a busy loop
-		//NOTE(denis): the epsilon is an attempt to lessen the effects of random spikes
-		f32 epsilon = 0.01f;
-		while (timeMs < (f64)1/(f64)60 * 1000.0 - epsilon)
-		{
-			QueryPerformanceCounter(&currentCounts);
-			timePassed = currentCounts.QuadPart - lastCounts.QuadPart;
-			timeMs = (f64)timePassed * 1000.0 / (f64)countFrequency.QuadPart;
-		}
-#if 0
-		char timeBuffer[100];
-		StringCbPrintf(timeBuffer, 100, "%f\n", timeMs);
-		OutputDebugString(timeBuffer);
-#endif
 		lastCounts = currentCounts;
+		lastFrameDelta = (f32)(timeMs/1000.0);
 
 		_currentTouchPoint = 0;
 		_input.touch = {};
@@ -616,6 +2076,14 @@ int CALLBACK WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine,
 		}
 	}
 	
+	win32_endInputRecording(&recorder);
+	appShutdown(_platform, (Memory*)mainMemory);
+	if (replayData)
+		HEAP_FREE(replayData);
+
+	if (fineSleep)
+		timeEndPeriod(1);
+
 	DestroyWindow(windowHandle);
 	
 	return 0;